@@ -0,0 +1,26 @@
+#!/bin/bash
+# Compares the compatibility graphs and cliques obtained with the pairwise
+# compatibility kernel (default) to those obtained by enumeration
+# (-validate) on the simulated instances. Run from the result directory.
+build_dir="../build/"
+tmp_dir=$(mktemp -d)
+trap "rm -rf $tmp_dir" EXIT
+
+status=0
+for d in n_5_perfect n_5_noisy n_5_inf_alleles_violations n_15_noisy
+do
+	echo "Checking instances in $d"
+	for f in ../data/sims/$d/*.data
+	do
+		$build_dir/cliques -v 0 $f > $tmp_dir/kernel.cliques
+		$build_dir/cliques -v 0 -validate $f > $tmp_dir/validate.cliques 2> $tmp_dir/validate.log
+		if grep -q "disagree" $tmp_dir/validate.log || ! cmp -s $tmp_dir/kernel.cliques $tmp_dir/validate.cliques
+		then
+			echo "$f: kernel differs from enumeration"
+			grep "disagree" $tmp_dir/validate.log
+			status=1
+		fi
+	done
+done
+
+exit $status
@@ -0,0 +1,55 @@
+#!/bin/bash
+# Stops enumerate with SIGTERM while it is enumerating a combination,
+# resumes it from the checkpoint and compares the result to that of an
+# uninterrupted run. Run from the result directory.
+#
+# Usage: ./check_resume.sh [input] [seconds before SIGTERM] [threads]
+build_dir="../build/"
+f=${1:-../data/sims/n_15_noisy/sims_r5_m10_n15_c1000.data}
+delay=${2:-5}
+threads=${3:-2}
+tmp_dir=$(mktemp -d)
+trap "rm -rf $tmp_dir" EXIT
+
+echo "Running $f without interruption..."
+$build_dir/enumerate -p -v 0 -t $threads $f > $tmp_dir/ref.res
+
+# the run may be stopped right after a combination was started, in which
+# case it is stopped again one second later
+for attempt in 1 2 3
+do
+	echo "Running $f, stopped after $delay seconds..."
+	timeout -s TERM $delay $build_dir/enumerate -p -v 0 -t $threads -checkpoint $tmp_dir/checkpoint -ci 1 $f > /dev/null
+	if [ $? -ne 124 ]
+	then
+		echo "The run finished before it was stopped, use a larger input or a shorter delay"
+		exit 1
+	fi
+	
+	# each running combination has a line with the number of its completed root tasks
+	if grep "#completed tasks" $tmp_dir/checkpoint | grep -qv "^0 "
+	then
+		break
+	elif [ $attempt -eq 3 ]
+	then
+		echo "The checkpoint has no completed root tasks of a running combination"
+		exit 1
+	fi
+	delay=$((delay + 1))
+done
+
+echo "Resuming $f..."
+$build_dir/enumerate -p -v 1 -t $threads -checkpoint $tmp_dir/checkpoint --resume $f > $tmp_dir/resume.res 2> $tmp_dir/resume.log
+if ! grep -q "^Skipping [1-9][0-9]* completed root tasks" $tmp_dir/resume.log
+then
+	echo "The resumed run did not skip the completed root tasks"
+	exit 1
+fi
+
+if [ "$(head -n 1 $tmp_dir/ref.res)" != "$(head -n 1 $tmp_dir/resume.res)" ]
+then
+	echo "Different number of solutions: $(head -n 1 $tmp_dir/ref.res) (uninterrupted), $(head -n 1 $tmp_dir/resume.res) (resumed)"
+	exit 1
+fi
+
+echo "OK"
@@ -0,0 +1,58 @@
+#!/bin/bash
+# Runs cliques and enumerate on the simulated instances with one thread and
+# with several threads, with and without -validate and with worker
+# processes, and reports every instance whose outputs differ. Instances for
+# which enumerate with one thread does not finish within time_limit seconds
+# are skipped and listed. Run from the result directory.
+#
+# Usage: ./check_threads.sh [threads] [instance directories...]
+build_dir="../build/"
+time_limit=30
+threads=${1:-4}
+shift
+dirs=${@:-n_5_perfect n_5_noisy n_5_inf_alleles_violations}
+tmp_dir=$(mktemp -d)
+trap "rm -rf $tmp_dir" EXIT
+
+# solutions are found in a different order by different threads, so each
+# solution after the solution count (ending with its #distance line) is put
+# on a single line and these lines are sorted
+normalize()
+{
+	awk 'NR > 2 { block = block $0 "|" } /^#distance/ { print block; block = "" }' $1 | sort
+}
+
+status=0
+for d in $dirs
+do
+	echo "Checking instances in $d"
+	for f in ../data/sims/$d/*.data
+	do
+		$build_dir/cliques -v 0 -t 1 $f > $tmp_dir/1.cliques
+		$build_dir/cliques -v 0 -t $threads $f > $tmp_dir/N.cliques
+		if ! cmp -s $tmp_dir/1.cliques $tmp_dir/N.cliques
+		then
+			echo "$f: cliques -t $threads differs from -t 1"
+			status=1
+		fi
+
+		if ! timeout -s KILL $time_limit $build_dir/enumerate -p -v 0 -t 1 $f > $tmp_dir/1.res 2> /dev/null
+		then
+			echo "$f: skipped, enumerate -t 1 takes longer than $time_limit seconds"
+			continue
+		fi
+		normalize $tmp_dir/1.res > $tmp_dir/1.sorted
+		for options in "-t $threads" "-t 1 -validate" "-t $threads -validate" "-t 1 -workers $threads"
+		do
+			$build_dir/enumerate -p -v 0 $options $f > $tmp_dir/N.res 2> /dev/null
+			normalize $tmp_dir/N.res > $tmp_dir/N.sorted
+			if [ "$(head -n 1 $tmp_dir/1.res)" != "$(head -n 1 $tmp_dir/N.res)" ] || ! cmp -s $tmp_dir/1.sorted $tmp_dir/N.sorted
+			then
+				echo "$f: enumerate $options differs from -t 1"
+				status=1
+			fi
+		done
+	done
+done
+
+exit $status
@@ -6,15 +6,22 @@
  */
 
 #include "bronkerbosch.h"
+#include <boost/thread.hpp>
 
 namespace gm {
 
 BronKerbosch::BronKerbosch(const Graph& g,
-                           int limit = -1)
+                           int limit,
+                           int threads)
   : _g(g)
   , _n(static_cast<size_t>(lemon::countNodes(_g)))
   , _limit(limit)
+  , _threads(threads)
+  , _type(BK_PIVOT_DEGENERACY)
+  , _minCliqueSize(-1)
+  , _bound(0)
   , _cliques()
+  , _nrCliques(0)
   , _bitToNode()
   , _nodeToBit(g, std::numeric_limits<size_t>::max())
   , _bitNeighborhood(g, BitSet(_n))
@@ -118,6 +125,7 @@ size_t BronKerbosch::computeDegeneracy(NodeList& order)
 
 void BronKerbosch::run(SolverType type)
 {
+  _type = type;
 
   switch (type)
   {
@@ -130,7 +138,7 @@ void BronKerbosch::run(SolverType type)
       if (type == BK_CLASSIC)
         bkClassic(P, R, X);
       else
-        bkPivot(P, R, X);
+        bkPivot(P, R, X, _cliques);
     }
     break;
   case BK_PIVOT_DEGENERACY:
@@ -140,10 +148,26 @@ void BronKerbosch::run(SolverType type)
       bkDegeneracy(order);
     }
     break;
+  case BK_MAXIMUM:
+    {
+      _bound = _minCliqueSize == -1 ? 1 : _minCliqueSize;
+      
+      NodeList order;
+      computeDegeneracy(order);
+      bkDegeneracy(order);
+      
+      // threads may have reported cliques before a larger one was found
+      const size_t bound = _bound;
+      _cliques.erase(std::remove_if(_cliques.begin(), _cliques.end(),
+                                    [bound](const NodeVector& C) { return C.size() < bound; }),
+                     _cliques.end());
+      _nrCliques = _cliques.size();
+    }
+    break;
   }
 }
 
-void BronKerbosch::report(const BitSet& R)
+void BronKerbosch::report(const BitSet& R, NodeVectorVector& cliques)
 {
   NodeVector clique;
   for (size_t i = 0; i < R.size(); ++i)
@@ -157,7 +181,8 @@ void BronKerbosch::report(const BitSet& R)
       clique.push_back(_bitToNode[i]);
     }
   }
-  _cliques.push_back(clique);
+  cliques.push_back(clique);
+  ++_nrCliques;
   if (g_verbosity >= VERBOSE_DEBUG)
     std::cerr << std::endl;
 }
@@ -186,23 +211,93 @@ void BronKerbosch::printBitSet(const BitSet& S, std::ostream& out) const
 
 void BronKerbosch::bkDegeneracy(const NodeList& order)
 {
-  BitSet mask(_n);
+  // the clique limit stops at a point of the serial order, threads would
+  // make the reported cliques depend on timing
+  if (_threads <= 1 || _limit != -1)
+  {
+    BitSet mask(_n);
 
-  for (typename NodeList::const_iterator it = order.begin(); it != order.end(); ++it)
+    for (typename NodeList::const_iterator it = order.begin(); it != order.end(); ++it)
+    {
+      Node v = *it;
+      // ~mask includes v but we're fine as _bitNeighborhood[v] excludes v
+      BitSet P = _bitNeighborhood[v] & ~mask;
+      BitSet X = _bitNeighborhood[v] & mask;
+      BitSet R(_n);
+      R.set(_nodeToBit[v]);
+
+      if (_type == BK_MAXIMUM)
+        bkMaximum(P, R, X, _cliques);
+      else
+        bkPivot(P, R, X, _cliques);
+      mask.set(_nodeToBit[v]);
+    }
+  }
+  else
   {
-    Node v = *it;
-    // ~mask includes v but we're fine as _bitNeighborhood[v] excludes v
-    BitSet P = _bitNeighborhood[v] & ~mask;
-    BitSet X = _bitNeighborhood[v] & mask;
-    BitSet R(_n);
+    // outer iterations are independent: P and X only depend on the position
+    // of the outer vertex in the order
+    NodeVector orderVector(order.begin(), order.end());
+    BitNodeMap position(_g);
+    for (size_t i = 0; i < orderVector.size(); ++i)
+    {
+      position[orderVector[i]] = i;
+    }
+
+    NodeVectorMatrix cliques(orderVector.size());
+    boost::atomic<int> nextVertex(0);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < _threads; ++i)
+    {
+      threadGroup.create_thread(boost::bind(&BronKerbosch::bkDegeneracyWorker, this,
+                                            boost::cref(orderVector),
+                                            boost::cref(position),
+                                            boost::ref(nextVertex),
+                                            boost::ref(cliques)));
+    }
+    threadGroup.join_all();
+
+    // merge in the order in which the serial algorithm reports cliques
+    for (NodeVectorVector& cliques_v : cliques)
+    {
+      _cliques.insert(_cliques.end(), cliques_v.begin(), cliques_v.end());
+    }
+  }
+}
+
+void BronKerbosch::bkDegeneracyWorker(const NodeVector& order,
+                                      const BitNodeMap& position,
+                                      boost::atomic<int>& nextVertex,
+                                      NodeVectorMatrix& cliques)
+{
+  const int nrVertices = order.size();
+  for (int idx = nextVertex++; idx < nrVertices; idx = nextVertex++)
+  {
+    Node v = order[idx];
+    const BitSet& N_v = _bitNeighborhood[v];
+
+    BitSet P(_n), X(_n), R(_n);
+    for (size_t i = N_v.find_first(); i != BitSet::npos; i = N_v.find_next(i))
+    {
+      if (position[_bitToNode[i]] < idx)
+      {
+        X.set(i);
+      }
+      else
+      {
+        P.set(i);
+      }
+    }
     R.set(_nodeToBit[v]);
 
-    bkPivot(P, R, X);
-    mask.set(_nodeToBit[v]);
+    if (_type == BK_MAXIMUM)
+      bkMaximum(P, R, X, cliques[idx]);
+    else
+      bkPivot(P, R, X, cliques[idx]);
   }
 }
 
-void BronKerbosch::bkPivot(BitSet P, BitSet R, BitSet X)
+void BronKerbosch::bkPivot(BitSet P, BitSet R, BitSet X, NodeVectorVector& cliques)
 {
   assert((P & X).none());
   assert((P & R).none());
@@ -217,7 +312,7 @@ void BronKerbosch::bkPivot(BitSet P, BitSet R, BitSet X)
   //print(X, std::cout);
   //std::cout << std::endl;
   
-  if (_limit != -1 && _cliques.size() > _limit)
+  if (_limit != -1 && _nrCliques > _limit)
   {
     // stop enumerating when limit is reached
     return;
@@ -227,7 +322,7 @@ void BronKerbosch::bkPivot(BitSet P, BitSet R, BitSet X)
   BitSet P_cup_X = P | X;
   if (P_cup_X.none())
   {
-    report(R);
+    report(R, cliques);
   }
   else
   {
@@ -259,7 +354,7 @@ void BronKerbosch::bkPivot(BitSet P, BitSet R, BitSet X)
         BitSet R_ = R;
         R_[_nodeToBit[v]] = 1;
         // report all maximal cliques in ( (P | N[v]) & R) \ (X & N[v]) )
-        bkPivot(P & _bitNeighborhood[v], R_, X & _bitNeighborhood[v]);
+        bkPivot(P & _bitNeighborhood[v], R_, X & _bitNeighborhood[v], cliques);
         P[i] = 0;
         X[i] = 1;
       }
@@ -275,6 +370,115 @@ void BronKerbosch::bkPivot(BitSet P, BitSet R, BitSet X)
    */
 }
 
+size_t BronKerbosch::colourBound(const BitSet& P) const
+{
+  // greedy sequential colouring, each colour class is an independent set
+  // and therefore contains at most one vertex of any clique
+  BitSet U = P;
+  size_t colours = 0;
+  while (U.any())
+  {
+    ++colours;
+    BitSet Q = U;
+    for (size_t i = Q.find_first(); i != BitSet::npos; i = Q.find_next(i))
+    {
+      U[i] = 0;
+      Q -= _bitNeighborhood[_bitToNode[i]];
+    }
+  }
+  
+  return colours;
+}
+
+void BronKerbosch::reportMaximum(const BitSet& R, NodeVectorVector& cliques)
+{
+  const size_t size = R.count();
+  if (_minCliqueSize == -1)
+  {
+    size_t bound = _bound;
+    while (bound < size && !_bound.compare_exchange_weak(bound, size));
+  }
+  
+  const size_t bound = _bound;
+  if (size < bound)
+    return;
+  
+  // discard cliques that are no longer of maximum size
+  if (!cliques.empty() && cliques.back().size() < bound)
+  {
+    // discarded cliques do not count towards the clique limit
+    const size_t nrCliques = cliques.size();
+    cliques.erase(std::remove_if(cliques.begin(), cliques.end(),
+                                 [bound](const NodeVector& C) { return C.size() < bound; }),
+                  cliques.end());
+    _nrCliques -= nrCliques - cliques.size();
+  }
+  
+  report(R, cliques);
+}
+
+void BronKerbosch::bkMaximum(BitSet P, BitSet R, BitSet X, NodeVectorVector& cliques)
+{
+  assert((P & X).none());
+  assert((P & R).none());
+  assert((R & X).none());
+  
+  if (_limit != -1 && _nrCliques > _limit)
+  {
+    // stop enumerating when limit is reached
+    return;
+  }
+  
+  // prune when P \cup R cannot contain a clique of size _bound
+  const size_t size_R = R.count();
+  if (size_R + P.count() < _bound || size_R + colourBound(P) < _bound)
+  {
+    return;
+  }
+  
+  // Reports maximal cliques in P \cup R (but not in X)
+  BitSet P_cup_X = P | X;
+  if (P_cup_X.none())
+  {
+    reportMaximum(R, cliques);
+  }
+  else
+  {
+    // choose a pivot u from (P | X) s.t |P & N(u)| is maximum, Tomita et al. (2006)
+    size_t maxBitCount = 0;
+    Node max_u = lemon::INVALID;
+    for (size_t i = 0; i < P.size(); ++i)
+    {
+      if (P_cup_X[i])
+      {
+        Node u = _bitToNode[i];
+        BitSet P_cap_Nu = P & _bitNeighborhood[u];
+        size_t s = P_cap_Nu.count();
+        if (s >= maxBitCount)
+        {
+          max_u = u;
+          maxBitCount = s;
+        }
+      }
+    }
+    
+    assert(max_u != lemon::INVALID);
+    BitSet P_diff_Nu = P - _bitNeighborhood[max_u];
+    for (size_t i = 0; i < P.size(); ++i)
+    {
+      if (P_diff_Nu[i])
+      {
+        Node v = _bitToNode[i];
+        BitSet R_ = R;
+        R_[_nodeToBit[v]] = 1;
+        bkMaximum(P & _bitNeighborhood[v], R_, X & _bitNeighborhood[v], cliques);
+        P[i] = 0;
+        X[i] = 1;
+      }
+    }
+  }
+}
+
 void BronKerbosch::bkClassic(BitSet P, BitSet R, BitSet X)
 {
   assert((P & X).none());
@@ -294,7 +498,7 @@ void BronKerbosch::bkClassic(BitSet P, BitSet R, BitSet X)
   BitSet P_cup_X = P | X;
   if (P_cup_X.none())
   {
-    report(R);
+    report(R, _cliques);
   }
   else
   {
@@ -9,11 +9,13 @@
 #define BRONKERBOSCH_H
 
 #include <iostream>
+#include <algorithm>
 #include <vector>
 #include <list>
 #include <limits>
 #include <set>
 #include <boost/dynamic_bitset.hpp>
+#include <boost/atomic.hpp>
 #include "utils.h"
 
 namespace gm {
@@ -27,7 +29,10 @@ public:
   {
     BK_CLASSIC,
     BK_PIVOT,
-    BK_PIVOT_DEGENERACY
+    BK_PIVOT_DEGENERACY,
+    /// Branch and bound on the degeneracy order that only reports maximal
+    /// cliques of maximum size, or of size at least getMinCliqueSize()
+    BK_MAXIMUM
   } SolverType;
 
   typedef std::vector<Node> NodeVector;
@@ -41,6 +46,7 @@ protected:
   typedef std::vector<NodeList> NodeListVector;
   typedef std::vector<NodeVector> NodeVectorVector;
   typedef NodeVectorVector::const_iterator NodeVectorVectorIt;
+  typedef std::vector<NodeVectorVector> NodeVectorMatrix;
   typedef std::map<int, NodeVectorVectorIt> CliqueItMap;
   typedef std::set<int> IntSet;
   
@@ -53,9 +59,21 @@ protected:
   };
 
 public:
-  BronKerbosch(const Graph& g, int limit);
+  BronKerbosch(const Graph& g, int limit, int threads = 1);
 
   void run(SolverType type);
+  
+  int getMinCliqueSize() const
+  {
+    return _minCliqueSize;
+  }
+  
+  /// Set the minimum size of the cliques reported by BK_MAXIMUM,
+  /// -1 means that only maximum cliques are reported
+  void setMinCliqueSize(int size)
+  {
+    _minCliqueSize = size;
+  }
 
   void print(std::ostream& out) const;
 
@@ -138,7 +156,7 @@ public:
   
   void sortBySize()
   {
-    std::sort(_cliques.begin(), _cliques.end(), CliqueComp());
+    std::stable_sort(_cliques.begin(), _cliques.end(), CliqueComp());
     
     if (_cliques.empty())
       return;
@@ -172,7 +190,17 @@ protected:
   const Graph& _g;
   const size_t _n;
   const int _limit;
+  /// Number of threads used by BK_PIVOT_DEGENERACY and BK_MAXIMUM, these run
+  /// serially if there is a clique limit
+  const int _threads;
+  SolverType _type;
+  int _minCliqueSize;
+  /// Size below which BK_MAXIMUM discards cliques, shared by all threads
+  boost::atomic<size_t> _bound;
   NodeVectorVector _cliques;
+  /// Number of maximal cliques reported so far, by all threads; for
+  /// BK_MAXIMUM only those that have not been discarded since
+  boost::atomic<size_t> _nrCliques;
   NodeVector _bitToNode;
   BitNodeMap _nodeToBit;
   BitSetNodeMap _bitNeighborhood;
@@ -181,7 +209,7 @@ protected:
 
   size_t computeDegeneracy(NodeList& order);
 
-  void report(const BitSet& R);
+  void report(const BitSet& R, NodeVectorVector& cliques);
 
   void printBitSet(const BitSet& S, std::ostream& out) const;
 
@@ -190,8 +218,21 @@ private:
   ///
   /// Reports maximal cliques in P \cup R (but not in X)
   void bkClassic(BitSet P, BitSet R, BitSet X);
-  void bkPivot(BitSet P, BitSet R, BitSet X);
+  void bkPivot(BitSet P, BitSet R, BitSet X, NodeVectorVector& cliques);
+  /// Pivoting Bron-Kerbosch algorithm that prunes P \cup R when it cannot
+  /// contain a clique of size _bound, using a greedy colouring of P
+  void bkMaximum(BitSet P, BitSet R, BitSet X, NodeVectorVector& cliques);
+  size_t colourBound(const BitSet& P) const;
+  void reportMaximum(const BitSet& R, NodeVectorVector& cliques);
   void bkDegeneracy(const NodeList& order);
+  
+  /// Runs bkPivot, or bkMaximum for BK_MAXIMUM, for the outer vertices of
+  /// the degeneracy order handed out by nextVertex, maximal cliques of
+  /// order[i] go to cliques[i]
+  void bkDegeneracyWorker(const NodeVector& order,
+                          const BitNodeMap& position,
+                          boost::atomic<int>& nextVertex,
+                          NodeVectorMatrix& cliques);
 };
 
 } // namespace gm
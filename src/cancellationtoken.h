@@ -0,0 +1,53 @@
+/*
+ * cancellationtoken.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef CANCELLATIONTOKEN_H
+#define CANCELLATIONTOKEN_H
+
+#include <boost/atomic.hpp>
+
+namespace gm {
+
+/// Flag that asks a computation to stop at its next check
+///
+/// A token is cancelled once its own flag or the flag of its parent has been
+/// set. Checking is lock free, so it is done at every search node. The
+/// computation returns the results obtained so far.
+class CancellationToken
+{
+public:
+  CancellationToken()
+    : _cancelled(false)
+    , _parent(NULL)
+  {
+  }
+  
+  /// Thread safe
+  void cancel()
+  {
+    _cancelled.store(true, boost::memory_order_relaxed);
+  }
+  
+  bool isCancelled() const
+  {
+    return _cancelled.load(boost::memory_order_relaxed)
+      || (_parent && _parent->isCancelled());
+  }
+  
+  /// Cancel this token whenever parent is cancelled
+  void setParent(const CancellationToken* parent)
+  {
+    _parent = parent;
+  }
+
+private:
+  boost::atomic<bool> _cancelled;
+  const CancellationToken* _parent;
+};
+
+} // namespace gm
+
+#endif // CANCELLATIONTOKEN_H
@@ -8,8 +8,6 @@
 #include "character.h"
 #include "utils.h"
 #include "stategraph.h"
-#include <boost/algorithm/string.hpp>
-#include <boost/lexical_cast.hpp>
 
 namespace gm {
   
@@ -56,9 +54,9 @@ void Character::remove(const IntPairSet& L0)
 }
   
 void Character::solve(int xy_max_c,
-                      int xy_max_overall,
                       bool includeMutationEdge,
-                      FrequencyMap& mapToF)
+                      FrequencyMap& mapToF,
+                      const FrequencyMap* candidates)
 {
   // 0. obtain L
   StateGraph::IntPairSet L;
@@ -71,89 +69,87 @@ void Character::solve(int xy_max_c,
   const StateGraph::StateEdgeSetSet& setS = StateGraph::getStateTrees(L, xy_max_c, includeMutationEdge);
   
   // 2. now check for each S in setS whether S is feasible
-  for (StateGraph::StateEdgeSetSetIt it = setS.begin(); it != setS.end(); ++it)
+  if (candidates)
   {
-    const StateGraph::StateEdgeSet& S = *it;
-    if (S.empty()) continue;
-    
-    StlRealIntervalTensor f(xy_max_overall + 1,
-                            StlRealIntervalMatrix(xy_max_overall + 1,
-                                                  StlRealIntervalVector(xy_max_overall + 1, std::make_pair(0, 0))));
-    
-    // 2a. get vertices of S
-    StateGraph::CnaTripleSet verticesS;
-    verticesS.insert(StateGraph::CnaTriple(1,1,0));
-    
-    int mut_x = -1, mut_y = -1;
-
-    for (StateGraph::StateEdgeSetIt it2 = S.begin(); it2 != S.end(); ++it2)
+    for (FrequencyMapIt it = candidates->begin(); it != candidates->end(); ++it)
     {
-      const StateGraph::CnaTriple& s = it2->first;
-      const StateGraph::CnaTriple& t = it2->second;
-      
-      verticesS.insert(s);
-      verticesS.insert(t);
-      
-      if (s._x == t._x && s._y == t._y)
+      const StateGraph::StateEdgeSet& S = it->first;
+      if (setS.find(S) != setS.end())
       {
-        mut_x = s._x;
-        mut_y = s._y;
+        solve(S, xy_max_c, mapToF);
       }
     }
+  }
+  else
+  {
+    for (StateGraph::StateEdgeSetSetIt it = setS.begin(); it != setS.end(); ++it)
+    {
+      solve(*it, xy_max_c, mapToF);
+    }
+  }
+}
+  
+void Character::solve(const StateGraph::StateEdgeSet& S,
+                      int xy_max_c,
+                      FrequencyMap& mapToF)
+{
+  if (S.empty()) return;
+  
+  // 2a. get vertices of S
+  StateGraph::CnaTripleSet verticesS;
+  verticesS.insert(StateGraph::CnaTriple(1,1,0));
+  
+  int mut_x = -1, mut_y = -1;
+
+  for (StateGraph::StateEdgeSetIt it2 = S.begin(); it2 != S.end(); ++it2)
+  {
+    const StateGraph::CnaTriple& s = it2->first;
+    const StateGraph::CnaTriple& t = it2->second;
     
-    // 2b. determine LB and UB for VAF
-    double numerator = 0;
-    double denominator = 0;
-    for (StateGraph::CnaTripleSetIt it2 = verticesS.begin(); it2 != verticesS.end(); ++it2)
+    verticesS.insert(s);
+    verticesS.insert(t);
+    
+    if (s._x == t._x && s._y == t._y)
     {
-      const StateGraph::CnaTriple& triple = *it2;
-      
-      numerator += triple._z * _M[triple._x][triple._y];
-      
-      // count mutation state at most once
-      if (!(triple._x == mut_x && triple._y == mut_y) || triple._z == 0)
-        denominator += (triple._x + triple._y) * _M[triple._x][triple._y];
+      mut_x = s._x;
+      mut_y = s._y;
     }
+  }
+  
+  // 2b. determine LB and UB for VAF
+  double numerator = 0;
+  double denominator = 0;
+  for (StateGraph::CnaTripleSetIt it2 = verticesS.begin(); it2 != verticesS.end(); ++it2)
+  {
+    const StateGraph::CnaTriple& triple = *it2;
     
-    double LB = mut_x != -1 ? (numerator - _M[mut_x][mut_y]) / denominator : numerator / denominator;
-    double UB = numerator / denominator;
+    numerator += triple._z * _M[triple._x][triple._y];
     
-    // 2c. stuff
-    RealInterval vaf_restricted = intersect(_vafLB, _vafUB, LB, UB);
-    if (!g_tol.less(vaf_restricted.second, vaf_restricted.first))
+    // count mutation state at most once
+    if (!(triple._x == mut_x && triple._y == mut_y) || triple._z == 0)
+      denominator += (triple._x + triple._y) * _M[triple._x][triple._y];
+  }
+  
+  double LB = mut_x != -1 ? (numerator - _M[mut_x][mut_y]) / denominator : numerator / denominator;
+  double UB = numerator / denominator;
+  
+  // 2c. stuff
+  RealInterval vaf_restricted = intersect(_vafLB, _vafUB, LB, UB);
+  if (!g_tol.less(vaf_restricted.second, vaf_restricted.first))
+  {
+    // only feasible state trees get a frequency tensor
+    StlRealIntervalTensor& f = mapToF[S];
+    f.assign(xy_max_c + 1,
+             StlRealIntervalMatrix(xy_max_c + 1,
+                                   StlRealIntervalVector(xy_max_c + 1, std::make_pair(0, 0))));
+    
+    for (StateGraph::CnaTripleSetIt it2 = verticesS.begin(); it2 != verticesS.end(); ++it2)
     {
-      for (StateGraph::CnaTripleSetIt it2 = verticesS.begin(); it2 != verticesS.end(); ++it2)
+      const StateGraph::CnaTriple& triple = *it2;
+      if (triple._x == mut_x && triple._y == mut_y && triple._z == 1)
       {
-        const StateGraph::CnaTriple& triple = *it2;
-        if (triple._x == mut_x && triple._y == mut_y && triple._z == 1)
-        {
-          f[triple._x][triple._y][triple._z].first = vaf_restricted.first * denominator - numerator + _M[mut_x][mut_y];
-          f[triple._x][triple._y][triple._z].second = vaf_restricted.second * denominator - numerator + _M[mut_x][mut_y];
-          
-          if (!g_tol.nonZero(f[triple._x][triple._y][triple._z].first))
-          {
-            f[triple._x][triple._y][triple._z].first = 0;
-          }
-          if (!g_tol.nonZero(f[triple._x][triple._y][triple._z].second))
-          {
-            f[triple._x][triple._y][triple._z].second = 0;
-          }
-          if (!g_tol.different(f[triple._x][triple._y][triple._z].first, f[triple._x][triple._y][triple._z].second))
-          {
-            f[triple._x][triple._y][triple._z].second = f[triple._x][triple._y][triple._z].first;
-          }
-          
-          assert(f[triple._x][triple._y][triple._z].first <= f[triple._x][triple._y][triple._z].second);
-          
-          f[triple._x][triple._y][0].first = _M[mut_x][mut_y] - f[triple._x][triple._y][triple._z].second;
-          f[triple._x][triple._y][0].second = _M[mut_x][mut_y] - f[triple._x][triple._y][triple._z].first;
-
-          assert(f[triple._x][triple._y][0].first <= f[triple._x][triple._y][0].second);
-        }
-        else if (triple._x != mut_x || triple._y != mut_y)
-        {
-          f[triple._x][triple._y][triple._z] = std::make_pair(_M[triple._x][triple._y], _M[triple._x][triple._y]);
-        }
+        f[triple._x][triple._y][triple._z].first = vaf_restricted.first * denominator - numerator + _M[mut_x][mut_y];
+        f[triple._x][triple._y][triple._z].second = vaf_restricted.second * denominator - numerator + _M[mut_x][mut_y];
         
         if (!g_tol.nonZero(f[triple._x][triple._y][triple._z].first))
         {
@@ -163,9 +159,31 @@ void Character::solve(int xy_max_c,
         {
           f[triple._x][triple._y][triple._z].second = 0;
         }
+        if (!g_tol.different(f[triple._x][triple._y][triple._z].first, f[triple._x][triple._y][triple._z].second))
+        {
+          f[triple._x][triple._y][triple._z].second = f[triple._x][triple._y][triple._z].first;
+        }
+        
+        assert(f[triple._x][triple._y][triple._z].first <= f[triple._x][triple._y][triple._z].second);
+        
+        f[triple._x][triple._y][0].first = _M[mut_x][mut_y] - f[triple._x][triple._y][triple._z].second;
+        f[triple._x][triple._y][0].second = _M[mut_x][mut_y] - f[triple._x][triple._y][triple._z].first;
+
+        assert(f[triple._x][triple._y][0].first <= f[triple._x][triple._y][0].second);
+      }
+      else if (triple._x != mut_x || triple._y != mut_y)
+      {
+        f[triple._x][triple._y][triple._z] = std::make_pair(_M[triple._x][triple._y], _M[triple._x][triple._y]);
       }
       
-      mapToF[S] = f;
+      if (!g_tol.nonZero(f[triple._x][triple._y][triple._z].first))
+      {
+        f[triple._x][triple._y][triple._z].first = 0;
+      }
+      if (!g_tol.nonZero(f[triple._x][triple._y][triple._z].second))
+      {
+        f[triple._x][triple._y][triple._z].second = 0;
+      }
     }
   }
 }
@@ -184,64 +202,114 @@ std::ostream& operator<<(std::ostream& out, const Character& c)
   return out;
 }
   
-std::istream& operator>>(std::istream& in, Character& c)
-{ 
-  std::string line;
-  gm::getline(in, line);
+void Character::parse(const char* first, const char* last)
+{
+  // fields are separated by a single tab or space, as in operator>>
+  struct Tokenizer
+  {
+    Tokenizer(const char* first, const char* last)
+      : _it(first)
+      , _last(last)
+      , _done(false)
+    {
+    }
+    
+    bool next(const char*& tokenFirst, const char*& tokenLast)
+    {
+      if (_done)
+        return false;
+      
+      tokenFirst = _it;
+      while (_it != _last && *_it != '\t' && *_it != ' ')
+      {
+        ++_it;
+      }
+      tokenLast = _it;
+      
+      if (_it == _last)
+        _done = true;
+      else
+        ++_it;
+      return true;
+    }
+    
+    const char* _it;
+    const char* _last;
+    bool _done;
+  };
   
-  StringVector s;
-  boost::split(s, line, boost::is_any_of("\t "));
+  // same message as for a boost::bad_lexical_cast
+  const char* badCast = "Error: bad lexical cast: source type value could not be interpreted as target";
   
-  try
+  Tokenizer tokenizer(first, last);
+  const char* s[7][2];
+  for (int i = 0; i < 7; ++i)
   {
-    c._sampleIndex = boost::lexical_cast<int>(s[0]);
-    c._sampleLabel = s[1];
-    c._characterIndex = boost::lexical_cast<int>(s[2]);
-    c._characterLabel = s[3];
-    c._vafLB = boost::lexical_cast<double>(s[4]);
-    c._vaf = boost::lexical_cast<double>(s[5]);
-    c._vafUB = boost::lexical_cast<double>(s[6]);
+    if (!tokenizer.next(s[i][0], s[i][1]))
+    {
+      throw std::runtime_error(getLineNumber() + "Error: expected at least 7 fields");
+    }
   }
-  catch (boost::bad_lexical_cast& e)
+  
+  if (!parseInt(s[0][0], s[0][1], _sampleIndex)
+      || !parseInt(s[2][0], s[2][1], _characterIndex)
+      || !parseDouble(s[4][0], s[4][1], _vafLB)
+      || !parseDouble(s[5][0], s[5][1], _vaf)
+      || !parseDouble(s[6][0], s[6][1], _vafUB))
   {
-    throw std::runtime_error(getLineNumber() + "Error: " + e.what());
+    throw std::runtime_error(getLineNumber() + badCast);
   }
+  _sampleLabel.assign(s[1][0], s[1][1]);
+  _characterLabel.assign(s[3][0], s[3][1]);
   
-  if (std::isnan(c._vafLB))
+  if (std::isnan(_vafLB))
   {
     throw std::runtime_error(getLineNumber() + "Error: vafLB should not be 'nan'");
   }
   
-  if (std::isnan(c._vafUB))
+  if (std::isnan(_vafUB))
   {
     throw std::runtime_error(getLineNumber() + "Error: vafUB should not be 'nan'");
   }
   
-  c._L.clear();
+  _L.clear();
   
-  int offset = 7;
-  int t = (s.size() - offset) / 3;
+  // an incomplete trailing copy state is ignored
   int max_x = -1, max_y = -1;
-  for (int i = 0; i < t; ++i)
+  const char* xyz[3][2];
+  while (tokenizer.next(xyz[0][0], xyz[0][1])
+         && tokenizer.next(xyz[1][0], xyz[1][1])
+         && tokenizer.next(xyz[2][0], xyz[2][1]))
   {
-    int x = boost::lexical_cast<int>(s[offset + 3*i]);
-    int y = boost::lexical_cast<int>(s[offset + 3*i + 1]);
-    double mu = boost::lexical_cast<double>(s[offset + 3*i + 2]);
+    int x = -1, y = -1;
+    double mu = 0;
+    if (!parseInt(xyz[0][0], xyz[0][1], x)
+        || !parseInt(xyz[1][0], xyz[1][1], y)
+        || !parseDouble(xyz[2][0], xyz[2][1], mu))
+    {
+      throw std::runtime_error(getLineNumber() + badCast);
+    }
     
     if (x > max_x) max_x = x;
     if (y > max_y) max_y = y;
     
-    Character::CopyState cpyState(x, y, mu);
-    
-    c._L.push_back(cpyState);
+    _L.push_back(CopyState(x, y, mu));
   }
   
-  c._M = StlDoubleMatrix(max_x + 1, StlDoubleVector(max_y + 1, 0));
-  for (Character::CopyStateListIt it = c._L.begin(); it != c._L.end(); ++it)
+  _M = StlDoubleMatrix(max_x + 1, StlDoubleVector(max_y + 1, 0));
+  for (CopyStateListIt it = _L.begin(); it != _L.end(); ++it)
   {
-    const Character::CopyState& cpyState = *it;
-    c._M[cpyState.x()][cpyState.y()] = cpyState.mu();
+    const CopyState& cpyState = *it;
+    _M[cpyState.x()][cpyState.y()] = cpyState.mu();
   }
+}
+  
+std::istream& operator>>(std::istream& in, Character& c)
+{ 
+  std::string line;
+  gm::getline(in, line);
+  
+  c.parse(line.data(), line.data() + line.size());
   
   return in;
 }
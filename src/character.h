@@ -79,18 +79,31 @@ public:
   
   void remove(const IntPairSet& L0);
   
+  /// Parses a line of the character matrix format in [first, last), throws
+  /// std::runtime_error if the line is malformed
+  void parse(const char* first, const char* last);
+  
   int sampleIndex() const { return _sampleIndex; }
   int characterIndex() const { return _characterIndex; }
   
   const std::string& sampleLabel() const { return _sampleLabel; }
   const std::string& characterLabel() const { return _characterLabel; }
   
+  /// Adds the state trees with copy numbers at most xy_max_c that are
+  /// compatible with this character to mapToF, the frequency tensor of a
+  /// state tree is indexed by the triples (x,y,z) with x,y <= xy_max_c.
+  /// If candidates is given, only its state trees are considered
   void solve(int xy_max_c,
-             int xy_max_overall,
              bool includeMutationEdge,
-             FrequencyMap& mapToF);
+             FrequencyMap& mapToF,
+             const FrequencyMap* candidates = NULL);
   
 private:
+  /// Adds S to mapToF if it is compatible with this character
+  void solve(const StateGraph::StateEdgeSet& S,
+             int xy_max_c,
+             FrequencyMap& mapToF);
+  
   friend std::ostream& operator<<(std::ostream& out, const Character& c);
   friend std::istream& operator>>(std::istream& in, Character& c);
   
@@ -8,6 +8,8 @@
 #include "charactermatrix.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
 
 namespace gm {
 
@@ -16,6 +18,8 @@ CharacterMatrix::CharacterMatrix()
   , _n(0)
   , _M()
   , _F()
+  , _f()
+  , _fOffset()
   , _maxX()
   , _maxXY(0)
   , _tripleToState()
@@ -23,6 +27,7 @@ CharacterMatrix::CharacterMatrix()
   , _stateLabel()
   , _charToInterval()
   , _intervals()
+  , _threads(1)
 {
 }
   
@@ -34,6 +39,8 @@ void CharacterMatrix::applyHeuristic()
   typedef std::vector<CnaTripleSetMap> CnaTripleSetMapVector;
   
   CnaTripleSetMapVector stateTreeVertexSet(_n);
+  StlRealIntervalVector newf;
+  StlIntVector newOffset(_n + 1, 0);
   for (int c = 0; c < _n; ++c)
   {
     int idx = 0;
@@ -72,32 +79,35 @@ void CharacterMatrix::applyHeuristic()
       }
     }
     
-    for (int p = 0; p < _m; ++p)
+    idx = 0;
+    Character::FrequencyMap newF;
+    newOffset[c] = newf.size();
+    for (Character::FrequencyMapIt it = _F[0][c].begin(); it != _F[0][c].end(); ++idx, ++it)
     {
-      idx = 0;
-      Character::FrequencyMap newF;
-      for (Character::FrequencyMapIt it = _F[p][c].begin(); it != _F[p][c].end(); ++idx, ++it)
+      if (retain.count(idx))
+      {
+        newF[it->first] = it->second;
+        
+        // the intervals of state tree idx are contiguous
+        StlRealIntervalVector::const_iterator first = _f.begin() + fIndex(idx, 0, c, 0);
+        newf.insert(newf.end(), first, first + _m * k());
+      }
+      else
       {
-        if (retain.count(idx))
+        if (g_verbosity >= VERBOSE_NON_ESSENTIAL)
         {
-          newF[it->first] = it->second;
-        }
-        else
-        {
-          if (p == 0)
-          {
-            if (g_verbosity >= VERBOSE_NON_ESSENTIAL)
-            {
-              std::cerr << "Removing character " <<  _M[0][c].characterLabel() << " (" << c << ") : ";
-              StateGraph::print(it->first, std::cerr);
-              std::cerr << std::endl;
-            }
-          }
+          std::cerr << "Removing character " <<  _M[0][c].characterLabel() << " (" << c << ") : ";
+          StateGraph::print(it->first, std::cerr);
+          std::cerr << std::endl;
         }
       }
-      _F[p][c] = newF;
     }
+    _F[0][c] = newF;
   }
+  newOffset[_n] = newf.size();
+  
+  _f.swap(newf);
+  _fOffset.swap(newOffset);
 }
   
 void CharacterMatrix::setIntervals(std::istream& in)
@@ -326,7 +336,7 @@ void CharacterMatrix::writeCompatibleStateTrees(std::ostream& out,
   // compute feasible state trees
   for (int p = 0; p < _m; ++p)
   {
-    _M[p][c].solve(_maxX[c], _maxXY, includeMutationEdge_c, _F[p][c]);
+    _M[p][c].solve(_maxX[c], includeMutationEdge_c, _F[p][c]);
   }
   
   typedef std::map<StateGraph::StateEdgeSet, IntSet> CountMap;
@@ -465,69 +475,25 @@ void CharacterMatrix::init()
   {
     std::cerr << std::endl << "Enumerating compatible state trees for each character ..." << std::endl;
   }
-  for (int p = 0; p < _m; ++p)
+  // each character c only writes to its own entries of _F, so the result
+  // does not depend on the number of threads
+  boost::atomic<int> nextCharacter(0);
+  boost::mutex outputMutex;
+  if (_threads <= 1)
   {
-    for (int c = 0; c < _n; ++c)
-    {
-      if (g_verbosity >= VERBOSE_NON_ESSENTIAL)
-      {
-        std::cerr << "Generating compatible state trees for character " << _M[p][c].characterLabel() << " (" << c
-                  << ") in sample " << _M[p][c].sampleLabel() << " (" << p << ") ..." << std::flush;
-      }
-
-      _M[p][c].solve(_maxX[c], _maxXY, includeMutationEdge[c], _F[p][c]);
-      
-      if (g_verbosity >= VERBOSE_NON_ESSENTIAL)
-      {
-        std::cerr << " Done: " << _F[p][c].size() << " state trees" << std::endl;
-      }
-    }
+    solveCharacters(includeMutationEdge, nextCharacter, outputMutex);
   }
-  
-  // compute intersection across samples for each character
-  for (int c = 0; c < _n; ++c)
+  else
   {
-    StateGraph::StateEdgeSetSet intersection;
-    const Character::FrequencyMap& F_0c = _F[0][c];
-    for (Character::FrequencyMapIt it = F_0c.begin(); it != F_0c.end(); ++it)
-    {
-      intersection.insert(it->first);
-    }
-    
-    for (int p = 1; p < _m; ++p)
+    boost::thread_group threadGroup;
+    for (int i = 0; i < _threads; ++i)
     {
-      const Character::FrequencyMap& F_pc = _F[p][c];
-      for (StateGraph::StateEdgeSetSetNonConstIt it = intersection.begin(); it != intersection.end();)
-      {
-        const StateGraph::StateEdgeSet& S = *it;
-        if (F_pc.find(S) == F_pc.end())
-        {
-          it = intersection.erase(it);
-        }
-        else
-        {
-          ++it;
-        }
-      }
-    }
-    
-    // now update state trees
-    for (int p = 0; p < _m; ++p)
-    {
-      Character::FrequencyMap& F_pc = _F[p][c];
-      for (Character::FrequencyMapNonConstIt it = F_pc.begin(); it != F_pc.end();)
-      {
-        const StateGraph::StateEdgeSet& S = it->first;
-        if (intersection.find(S) == intersection.end())
-        {
-          it = F_pc.erase(it);
-        }
-        else
-        {
-          ++it;
-        }
-      }
+      threadGroup.create_thread(boost::bind(&CharacterMatrix::solveCharacters, this,
+                                            boost::cref(includeMutationEdge),
+                                            boost::ref(nextCharacter),
+                                            boost::ref(outputMutex)));
     }
+    threadGroup.join_all();
   }
   
 //  for (int p = 0; p < _m; ++p)
@@ -590,6 +556,105 @@ void CharacterMatrix::init()
     snprintf(buf, 1024, "(%d,%d,%d)", triple._x, triple._y, triple._z);
     _stateLabel[i] = buf;
   }
+  
+  initFrequencies();
+}
+  
+void CharacterMatrix::initFrequencies()
+{
+  const int kk = k();
+  
+  _fOffset = StlIntVector(_n + 1, 0);
+  for (int c = 0; c < _n; ++c)
+  {
+    _fOffset[c + 1] = _fOffset[c] + numStateTrees(c) * _m * kk;
+  }
+  
+  _f = StlRealIntervalVector(_fOffset[_n], RealInterval(0, 0));
+  for (int c = 0; c < _n; ++c)
+  {
+    // F_pc has the same state trees in the same order for all samples p
+    for (int p = 0; p < _m; ++p)
+    {
+      int s = 0;
+      const Character::FrequencyMap& F_pc = _F[p][c];
+      for (Character::FrequencyMapIt it = F_pc.begin(); it != F_pc.end(); ++it, ++s)
+      {
+        const StlRealIntervalTensor& f = it->second;
+        for (int i = 0; i < kk; ++i)
+        {
+          // the tensor only covers the copy numbers of character c
+          const StateGraph::CnaTriple& triple = _stateToTriple[i];
+          if (triple._x < f.size() && triple._y < f.size())
+          {
+            _f[fIndex(s, p, c, i)] = f[triple._x][triple._y][triple._z];
+          }
+        }
+      }
+    }
+    
+    for (int p = 1; p < _m; ++p)
+    {
+      _F[p][c].clear();
+    }
+    for (Character::FrequencyMapNonConstIt it = _F[0][c].begin(); it != _F[0][c].end(); ++it)
+    {
+      StlRealIntervalTensor().swap(it->second);
+    }
+  }
+}
+  
+void CharacterMatrix::solveCharacters(const StlBoolVector& includeMutationEdge,
+                                      boost::atomic<int>& nextCharacter,
+                                      boost::mutex& outputMutex)
+{
+  for (int c = nextCharacter++; c < _n; c = nextCharacter++)
+  {
+    // a state tree that is infeasible in a sample is not considered in the
+    // samples that follow, so _F[_m-1][c] ends up being the intersection
+    for (int p = 0; p < _m; ++p)
+    {
+      if (p == 0)
+      {
+        _M[p][c].solve(_maxX[c], includeMutationEdge[c], _F[p][c]);
+      }
+      else if (!_F[p-1][c].empty())
+      {
+        _M[p][c].solve(_maxX[c], includeMutationEdge[c], _F[p][c], &_F[p-1][c]);
+      }
+      
+      if (g_verbosity >= VERBOSE_NON_ESSENTIAL)
+      {
+        boost::interprocess::scoped_lock<boost::mutex> lock(outputMutex);
+        std::cerr << "Generating compatible state trees for character " << _M[p][c].characterLabel() << " (" << c
+                  << ") in sample " << _M[p][c].sampleLabel() << " (" << p << ") ..."
+                  << " Done: " << _F[p][c].size() << " state trees" << std::endl;
+      }
+    }
+    
+    intersectStateTrees(c);
+  }
+}
+  
+void CharacterMatrix::intersectStateTrees(int c)
+{
+  const Character::FrequencyMap& F_lastc = _F[_m-1][c];
+  for (int p = 0; p < _m - 1; ++p)
+  {
+    Character::FrequencyMap& F_pc = _F[p][c];
+    for (Character::FrequencyMapNonConstIt it = F_pc.begin(); it != F_pc.end();)
+    {
+      const StateGraph::StateEdgeSet& S = it->first;
+      if (F_lastc.find(S) == F_lastc.end())
+      {
+        it = F_pc.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
 }
   
 std::ostream& operator<<(std::ostream& out, const CharacterMatrix& M)
@@ -608,17 +673,18 @@ std::ostream& operator<<(std::ostream& out, const CharacterMatrix& M)
   return out;
 }
   
-std::istream& operator>>(std::istream& in, CharacterMatrix& M)
+void CharacterMatrix::read(const char* first, const char* last)
 {
   g_lineNumber = 0;
   
-  std::string line;
-  gm::getline(in, line);
+  const char* lineFirst = first;
+  const char* lineLast = NULL;
+  first = gm::getline(lineFirst, last, lineLast);
   
   int m = -1;
   int n = -1;
   
-  std::stringstream ss(line);
+  std::stringstream ss(std::string(lineFirst, lineLast));
   ss >> m;
   
   if (m <= 0)
@@ -626,9 +692,10 @@ std::istream& operator>>(std::istream& in, CharacterMatrix& M)
     throw std::runtime_error(getLineNumber() + "Error: m should be nonnegative");
   }
   
-  gm::getline(in, line);
+  lineFirst = first;
+  first = gm::getline(lineFirst, last, lineLast);
   ss.clear();
-  ss.str(line);
+  ss.str(std::string(lineFirst, lineLast));
   ss >> n;
   
   if (n <= 0)
@@ -636,22 +703,20 @@ std::istream& operator>>(std::istream& in, CharacterMatrix& M)
     throw std::runtime_error(getLineNumber() + "Error: n should be nonnegative");
   }
   
-  M._m = m;
-  M._n = n;
-  M._M = CharacterMatrix::StlCharacterMatrix(m, CharacterMatrix::StlCharacterVector(n));
+  _m = m;
+  _n = n;
+  _M = StlCharacterMatrix(m, StlCharacterVector(n));
   StlBoolMatrix present(m, StlBoolVector(n, false));
   
-  while (in.good())
+  while (first != last)
   {
-    gm::getline(in, line);
-    if (line == "" || line[0] == '#')
+    lineFirst = first;
+    first = gm::getline(lineFirst, last, lineLast);
+    if (lineFirst == lineLast || *lineFirst == '#')
       continue;
     
-    ss.clear();
-    ss.str(line);
-    
     Character character;
-    ss >> character;
+    character.parse(lineFirst, lineLast);
     
     int c = character.characterIndex();
     int p = character.sampleIndex();
@@ -674,7 +739,7 @@ std::istream& operator>>(std::istream& in, CharacterMatrix& M)
                                + ")");
     }
     
-    M._M[p][c] = character;
+    std::swap(_M[p][c], character);
     present[p][c] = true;
   }
   
@@ -692,6 +757,13 @@ std::istream& operator>>(std::istream& in, CharacterMatrix& M)
       }
     }
   }
+}
+  
+std::istream& operator>>(std::istream& in, CharacterMatrix& M)
+{
+  const std::string data((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+  M.read(data.data(), data.data() + data.size());
   
   return in;
 }
@@ -11,6 +11,8 @@
 #include "utils.h"
 #include "character.h"
 #include "statetree.h"
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace gm {
 
@@ -26,8 +28,21 @@ public:
 
   CharacterMatrix();
   
+  /// Enumerates the compatible state trees of each character in each
+  /// sample and keeps those that are compatible in all samples
   void init();
   
+  int getThreads() const
+  {
+    return _threads;
+  }
+  
+  /// Number of threads used by init(), the result does not depend on it
+  void setThreads(int threads)
+  {
+    _threads = threads;
+  }
+  
   void writeCompatibleStateTrees(const StlDoubleVector& purityValues,
                                  std::ostream& out);
   
@@ -120,6 +135,10 @@ public:
   
   void applyHeuristic();
   
+  /// Parses the character matrix in [first, last), as operator>> does for
+  /// a stream. Throws std::runtime_error if the input is malformed
+  void read(const char* first, const char* last);
+  
 private:
   typedef std::vector<Character> StlCharacterVector;
   typedef std::vector<StlCharacterVector> StlCharacterMatrix;
@@ -136,53 +155,75 @@ private:
 public:
   double get_f_lb(int s, int p, int c, int i) const
   {
-    assert(0 <= i && i < k());
-    return get_f_lb(s, p, c, _stateToTriple[i]._x, _stateToTriple[i]._y, _stateToTriple[i]._z);
+    return _f[fIndex(s, p, c, i)].first;
   }
   
   double get_f_lb(int s, int p, int c, int x, int y, int z) const
   {
-    assert(0 <= p && p < _m);
-    assert(0 <= c && c < _n);
-    assert(0 <= s && s < _F[p][c].size());
     assert(0 <= x && x <= _maxXY);
     assert(0 <= y && y <= _maxXY);
     assert(0 <= z && z <= x);
     
-    Character::FrequencyMapIt it = _F[p][c].begin();
-    for (int i = 0; i < s; ++i) ++it;
-    
-    const StlRealIntervalTensor& freqMap = it->second;
-    
-    return freqMap[x][y][z].first;
+    int i = tripleToState(CnaTriple(x, y, z));
+    return i == -1 ? 0 : get_f_lb(s, p, c, i);
   }
   
   double get_f_ub(int s, int p, int c, int i) const
   {
-    assert(0 <= i && i < k());
-    return get_f_ub(s, p, c, _stateToTriple[i]._x, _stateToTriple[i]._y, _stateToTriple[i]._z);
+    return _f[fIndex(s, p, c, i)].second;
   }
   
   double get_f_ub(int s, int p, int c, int x, int y, int z) const
   {
-    assert(0 <= p && p < _m);
-    assert(0 <= c && c < _n);
-    assert(0 <= s && s < _F[p][c].size());
     assert(0 <= x && x <= _maxXY);
     assert(0 <= y && y <= _maxXY);
     assert(0 <= z && z <= x);
     
-    Character::FrequencyMapIt it = _F[p][c].begin();
-    for (int i = 0; i < s; ++i) ++it;
+    int i = tripleToState(CnaTriple(x, y, z));
+    return i == -1 ? 0 : get_f_ub(s, p, c, i);
+  }
+  
+private:
+  /// Index of the frequency interval of state i in sample p for state tree s
+  /// of character c in _f
+  int fIndex(int s, int p, int c, int i) const
+  {
+    assert(0 <= p && p < _m);
+    assert(0 <= c && c < _n);
+    assert(0 <= s && s < _F[0][c].size());
+    assert(0 <= i && i < k());
     
-    return it->second[x][y][z].second;
+    return _fOffset[c] + (s * _m + p) * k() + i;
   }
   
+  /// Copies the frequency intervals of the state trees in _F to _f, and
+  /// releases the frequency tensors and the state trees of the samples p > 0
+  void initFrequencies();
+  
+private:
+  /// Solves the characters handed out by nextCharacter, one sample after the
+  /// other, each sample only considers the state trees that are compatible
+  /// in the samples before it
+  void solveCharacters(const StlBoolVector& includeMutationEdge,
+                       boost::atomic<int>& nextCharacter,
+                       boost::mutex& outputMutex);
+  
+  /// Restricts the state trees of character c in all samples to those that
+  /// are compatible in the last sample
+  void intersectStateTrees(int c);
+  
 private:
   int _m;
   int _n;
   StlCharacterMatrix _M;
+  /// After init(), only the state trees of sample 0 are retained and their
+  /// frequency tensors are empty
   FrequencyMapMatrix _F;
+  /// Frequency intervals of each state tree s of character c, in sample p
+  /// and state i, see fIndex
+  StlRealIntervalVector _f;
+  /// Start of the intervals of character c in _f
+  StlIntVector _fOffset;
   StlIntVector _maxX;
   int _maxXY;
   
@@ -193,8 +234,9 @@ private:
   IntSetVector _charToInterval;
   IntSetSet _intervals;
   
+  int _threads;
+  
   friend std::ostream& operator<<(std::ostream& out, const CharacterMatrix& M);
-  friend std::istream& operator>>(std::istream& in, CharacterMatrix& M);
 };
 
 std::ostream& operator<<(std::ostream& out, const CharacterMatrix& M);
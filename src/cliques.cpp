@@ -9,6 +9,7 @@
 #include "config.h"
 #include "charactermatrix.h"
 #include "compatibilitygraph.h"
+#include "mappedfile.h"
 #include <fstream>
 #include <lemon/arg_parser.h>
 #include <boost/algorithm/string.hpp>
@@ -22,13 +23,19 @@ int main(int argc, char** argv)
   std::string filterString;
   int verbosityLevel = 1;
   int cliqueLimit = -1;
+  int threads = 1;
+  bool validation = false;
+  std::string cacheFilename;
   
   lemon::ArgParser ap(argc, argv);
   ap.boolOption("-version", "Show version number")
     .refOption("v", "Verbosity level (default: 1)", verbosityLevel)
     .refOption("s", "Maximal clique size (default: -1 (maximum))", size)
     .refOption("f", "Filter (default : \"\")", filterString)
-    .refOption("l", "Clique limit (default : -1 (unlimited))", cliqueLimit)
+    .refOption("l", "Maximum number of reported cliques (default : -1 (unlimited))", cliqueLimit)
+    .refOption("t", "Number of threads (default: 1)", threads)
+    .refOption("validate", "Cross-check compatibility kernel against enumeration, the enumeration result is used", validation)
+    .refOption("cache", "Compatibility cache file, created if it does not exist", cacheFilename)
     .other("input", "Input file");
   ap.parse();
   
@@ -54,6 +61,7 @@ int main(int argc, char** argv)
               << "' for reading" << std::endl;
     return 1;
   }
+  inFile.close();
   
   IntPairSet filter;
   IntSet whiteList;
@@ -72,7 +80,8 @@ int main(int argc, char** argv)
   CharacterMatrix M;
   try
   {
-    inFile >> M;
+    MappedFile inputFile(inputFilename);
+    M.read(inputFile.begin(), inputFile.end());
   }
   catch (std::runtime_error& e)
   {
@@ -80,13 +89,47 @@ int main(int argc, char** argv)
     return 1;
   }
   
+  M.setThreads(threads);
   M.init();
   M.applyHeuristic();
   
   CompatibilityGraph G(M);
   G.setCliqueLimit(cliqueLimit);
+  G.setThreads(threads);
+  G.setValidation(validation);
+  
+  if (!cacheFilename.empty())
+  {
+    std::ifstream cacheFile(cacheFilename.c_str());
+    if (cacheFile.good())
+    {
+      try
+      {
+        G.readCache(cacheFile);
+      }
+      catch (std::runtime_error& e)
+      {
+        std::cerr << "File: '" << cacheFilename << "'. " << e.what() << std::endl;
+        return 1;
+      }
+    }
+  }
+  
   G.init(filter, size);
   
+  if (!cacheFilename.empty())
+  {
+    std::ofstream cacheFile(cacheFilename.c_str());
+    if (cacheFile.good())
+    {
+      G.writeCache(cacheFile);
+    }
+    if (!cacheFile.good())
+    {
+      std::cerr << "Unable to write compatibility cache '" << cacheFilename << "'" << std::endl;
+    }
+  }
+  
   G.write(std::cout);
   
   return 0;
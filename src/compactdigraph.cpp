@@ -0,0 +1,93 @@
+/*
+ * compactdigraph.cpp
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#include "compactdigraph.h"
+
+namespace gm {
+
+CompactDigraph::CompactDigraph(const Digraph& G)
+  : _G(G)
+  , _nodeFromId(G.maxNodeId() + 1, Node(lemon::INVALID))
+  , _arcFromId(G.maxArcId() + 1, Arc(lemon::INVALID))
+  , _nodes()
+  , _arcs()
+  , _nodeMask(G.maxNodeId() + 1)
+  , _arcMask(G.maxArcId() + 1)
+  , _source(G.maxArcId() + 1, -1)
+  , _target(G.maxArcId() + 1, -1)
+  , _outOffset(G.maxNodeId() + 2, 0)
+  , _outArcs()
+  , _inOffset(G.maxNodeId() + 2, 0)
+  , _inArcs()
+{
+  for (NodeIt v(G); v != lemon::INVALID; ++v)
+  {
+    _nodeFromId[G.id(v)] = v;
+    _nodes.push_back(G.id(v));
+    _nodeMask.set(G.id(v));
+  }
+  
+  for (ArcIt a(G); a != lemon::INVALID; ++a)
+  {
+    const int id_a = G.id(a);
+    _arcFromId[id_a] = a;
+    _arcs.push_back(id_a);
+    _arcMask.set(id_a);
+    _source[id_a] = G.id(G.source(a));
+    _target[id_a] = G.id(G.target(a));
+  }
+  
+  // ranges follow the node ids, arcs within a range follow the iteration
+  // order of the out-arcs (in-arcs) of the node
+  const int nrNodeIds = _nodeFromId.size();
+  for (int v = 0; v < nrNodeIds; ++v)
+  {
+    _outOffset[v] = _outArcs.size();
+    _inOffset[v] = _inArcs.size();
+    if (_nodeFromId[v] == lemon::INVALID)
+      continue;
+    
+    for (OutArcIt a(G, _nodeFromId[v]); a != lemon::INVALID; ++a)
+    {
+      _outArcs.push_back(G.id(a));
+    }
+    for (InArcIt a(G, _nodeFromId[v]); a != lemon::INVALID; ++a)
+    {
+      _inArcs.push_back(G.id(a));
+    }
+  }
+  _outOffset[nrNodeIds] = _outArcs.size();
+  _inOffset[nrNodeIds] = _inArcs.size();
+}
+
+void CompactSubDigraph::reached(Node root, BitSet& result) const
+{
+  result.resize(_nodes.size());
+  result.reset();
+  
+  const int id_root = _G->id(root);
+  if (!_nodes[id_root])
+    return;
+  
+  StlIntVector queue(1, id_root);
+  result.set(id_root);
+  for (size_t head = 0; head < queue.size(); ++head)
+  {
+    const int v = queue[head];
+    for (int idx = _G->outBegin(v); idx != _G->outEnd(v); ++idx)
+    {
+      const int a = _G->outArc(idx);
+      const int w = _G->targetId(a);
+      if (_arcs[a] && _nodes[w] && !result[w])
+      {
+        result.set(w);
+        queue.push_back(w);
+      }
+    }
+  }
+}
+
+} // namespace gm
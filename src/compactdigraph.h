@@ -0,0 +1,466 @@
+/*
+ * compactdigraph.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef COMPACTDIGRAPH_H
+#define COMPACTDIGRAPH_H
+
+#include "utils.h"
+#include <boost/dynamic_bitset.hpp>
+
+namespace gm {
+
+/// Static snapshot of a digraph in compressed sparse row form
+///
+/// Arc endpoints are stored in contiguous arrays indexed by arc id, and the
+/// out- and in-arcs of each node occupy a contiguous range. Ids are those of
+/// the underlying digraph, and ranges preserve its iteration order, so the
+/// snapshot must be rebuilt whenever the digraph changes.
+class CompactDigraph
+{
+public:
+  DIGRAPH_TYPEDEFS(Digraph);
+  typedef std::vector<Node> NodeVector;
+  typedef std::vector<Arc> ArcVector;
+  
+  CompactDigraph(const Digraph& G);
+  
+  const Digraph& G() const
+  {
+    return _G;
+  }
+  
+  int nodeNum() const
+  {
+    return _nodeFromId.size();
+  }
+  
+  int arcNum() const
+  {
+    return _arcFromId.size();
+  }
+  
+  int id(Node v) const
+  {
+    return _G.id(v);
+  }
+  
+  int id(Arc a) const
+  {
+    return _G.id(a);
+  }
+  
+  Node nodeFromId(int v) const
+  {
+    return _nodeFromId[v];
+  }
+  
+  Arc arcFromId(int a) const
+  {
+    return _arcFromId[a];
+  }
+  
+  int sourceId(int a) const
+  {
+    return _source[a];
+  }
+  
+  int targetId(int a) const
+  {
+    return _target[a];
+  }
+  
+  /// Nodes in iteration order of the underlying digraph
+  const StlIntVector& nodes() const
+  {
+    return _nodes;
+  }
+  
+  /// Arcs in iteration order of the underlying digraph
+  const StlIntVector& arcs() const
+  {
+    return _arcs;
+  }
+  
+  int outBegin(int v) const
+  {
+    return _outOffset[v];
+  }
+  
+  int outEnd(int v) const
+  {
+    return _outOffset[v + 1];
+  }
+  
+  int outArc(int idx) const
+  {
+    return _outArcs[idx];
+  }
+  
+  int inBegin(int v) const
+  {
+    return _inOffset[v];
+  }
+  
+  int inEnd(int v) const
+  {
+    return _inOffset[v + 1];
+  }
+  
+  int inArc(int idx) const
+  {
+    return _inArcs[idx];
+  }
+  
+  /// Ids that correspond to a node of the underlying digraph
+  const boost::dynamic_bitset<>& nodeMask() const
+  {
+    return _nodeMask;
+  }
+  
+  /// Ids that correspond to an arc of the underlying digraph
+  const boost::dynamic_bitset<>& arcMask() const
+  {
+    return _arcMask;
+  }
+
+private:
+  const Digraph& _G;
+  
+  NodeVector _nodeFromId;
+  ArcVector _arcFromId;
+  
+  StlIntVector _nodes;
+  StlIntVector _arcs;
+  boost::dynamic_bitset<> _nodeMask;
+  boost::dynamic_bitset<> _arcMask;
+  
+  /// Source node id of each arc
+  StlIntVector _source;
+  /// Target node id of each arc
+  StlIntVector _target;
+  
+  /// Out-arcs of node v are _outArcs[_outOffset[v], _outOffset[v+1])
+  StlIntVector _outOffset;
+  StlIntVector _outArcs;
+  /// In-arcs of node v are _inArcs[_inOffset[v], _inOffset[v+1])
+  StlIntVector _inOffset;
+  StlIntVector _inArcs;
+};
+
+/// Subgraph of a CompactDigraph whose node and arc sets are bitsets
+///
+/// Provides the part of the lemon::SubDigraph interface used by the
+/// enumeration algorithms. Copying a subgraph or comparing its node and arc
+/// sets amounts to a few word operations.
+class CompactSubDigraph
+{
+public:
+  typedef Digraph::Node Node;
+  typedef Digraph::Arc Arc;
+  typedef boost::dynamic_bitset<> BitSet;
+  
+  CompactSubDigraph(const CompactDigraph& G, bool enabled)
+    : _G(&G)
+    , _nodes(G.nodeNum())
+    , _arcs(G.arcNum())
+  {
+    if (enabled)
+    {
+      enableAll();
+    }
+  }
+  
+  const CompactDigraph& compactG() const
+  {
+    return *_G;
+  }
+  
+  bool status(Node v) const
+  {
+    return _nodes[_G->id(v)];
+  }
+  
+  bool status(Arc a) const
+  {
+    return _arcs[_G->id(a)];
+  }
+  
+  void status(Node v, bool enabled)
+  {
+    _nodes[_G->id(v)] = enabled;
+  }
+  
+  void status(Arc a, bool enabled)
+  {
+    _arcs[_G->id(a)] = enabled;
+  }
+  
+  void enable(Node v)
+  {
+    _nodes.set(_G->id(v));
+  }
+  
+  void enable(Arc a)
+  {
+    _arcs.set(_G->id(a));
+  }
+  
+  void disable(Node v)
+  {
+    _nodes.reset(_G->id(v));
+  }
+  
+  void disable(Arc a)
+  {
+    _arcs.reset(_G->id(a));
+  }
+  
+  Node source(Arc a) const
+  {
+    return _G->G().source(a);
+  }
+  
+  Node target(Arc a) const
+  {
+    return _G->G().target(a);
+  }
+  
+  /// Enables all nodes and arcs of the underlying digraph
+  void enableAll()
+  {
+    _nodes = _G->nodeMask();
+    _arcs = _G->arcMask();
+  }
+  
+  const BitSet& nodes() const
+  {
+    return _nodes;
+  }
+  
+  const BitSet& arcs() const
+  {
+    return _arcs;
+  }
+  
+  BitSet& nodes()
+  {
+    return _nodes;
+  }
+  
+  BitSet& arcs()
+  {
+    return _arcs;
+  }
+  
+  /// Returns the set of nodes reachable from root using enabled arcs
+  /// whose endpoints are enabled
+  void reached(Node root, BitSet& result) const;
+  
+  class NodeIt : public Node
+  {
+  public:
+    NodeIt()
+    {
+    }
+    
+    NodeIt(lemon::Invalid)
+      : Node(lemon::INVALID)
+      , _T(NULL)
+      , _idx(0)
+    {
+    }
+    
+    NodeIt(const CompactSubDigraph& T)
+      : _T(&T)
+      , _idx(0)
+    {
+      next();
+    }
+    
+    NodeIt& operator++()
+    {
+      ++_idx;
+      next();
+      return *this;
+    }
+  
+  private:
+    void next()
+    {
+      const StlIntVector& nodes = _T->_G->nodes();
+      const int size = nodes.size();
+      while (_idx < size && !_T->_nodes[nodes[_idx]])
+      {
+        ++_idx;
+      }
+      static_cast<Node&>(*this) = _idx < size ? _T->_G->nodeFromId(nodes[_idx]) : Node(lemon::INVALID);
+    }
+    
+    const CompactSubDigraph* _T;
+    int _idx;
+  };
+  
+  class ArcIt : public Arc
+  {
+  public:
+    ArcIt()
+    {
+    }
+    
+    ArcIt(lemon::Invalid)
+      : Arc(lemon::INVALID)
+      , _T(NULL)
+      , _idx(0)
+    {
+    }
+    
+    ArcIt(const CompactSubDigraph& T)
+      : _T(&T)
+      , _idx(0)
+    {
+      next();
+    }
+    
+    ArcIt& operator++()
+    {
+      ++_idx;
+      next();
+      return *this;
+    }
+  
+  private:
+    void next()
+    {
+      const StlIntVector& arcs = _T->_G->arcs();
+      const int size = arcs.size();
+      while (_idx < size && !_T->isEnabled(arcs[_idx]))
+      {
+        ++_idx;
+      }
+      static_cast<Arc&>(*this) = _idx < size ? _T->_G->arcFromId(arcs[_idx]) : Arc(lemon::INVALID);
+    }
+    
+    const CompactSubDigraph* _T;
+    int _idx;
+  };
+  
+  class OutArcIt : public Arc
+  {
+  public:
+    OutArcIt()
+    {
+    }
+    
+    OutArcIt(lemon::Invalid)
+      : Arc(lemon::INVALID)
+      , _T(NULL)
+      , _idx(0)
+      , _end(0)
+    {
+    }
+    
+    OutArcIt(const CompactSubDigraph& T, Node v)
+      : _T(&T)
+      , _idx(T._G->outBegin(T._G->id(v)))
+      , _end(T._G->outEnd(T._G->id(v)))
+    {
+      next();
+    }
+    
+    OutArcIt& operator++()
+    {
+      ++_idx;
+      next();
+      return *this;
+    }
+  
+  private:
+    void next()
+    {
+      while (_idx < _end && !_T->isOutArcEnabled(_T->_G->outArc(_idx)))
+      {
+        ++_idx;
+      }
+      static_cast<Arc&>(*this) = _idx < _end ? _T->_G->arcFromId(_T->_G->outArc(_idx)) : Arc(lemon::INVALID);
+    }
+    
+    const CompactSubDigraph* _T;
+    int _idx;
+    int _end;
+  };
+  
+  class InArcIt : public Arc
+  {
+  public:
+    InArcIt()
+    {
+    }
+    
+    InArcIt(lemon::Invalid)
+      : Arc(lemon::INVALID)
+      , _T(NULL)
+      , _idx(0)
+      , _end(0)
+    {
+    }
+    
+    InArcIt(const CompactSubDigraph& T, Node v)
+      : _T(&T)
+      , _idx(T._G->inBegin(T._G->id(v)))
+      , _end(T._G->inEnd(T._G->id(v)))
+    {
+      next();
+    }
+    
+    InArcIt& operator++()
+    {
+      ++_idx;
+      next();
+      return *this;
+    }
+  
+  private:
+    void next()
+    {
+      while (_idx < _end && !_T->isInArcEnabled(_T->_G->inArc(_idx)))
+      {
+        ++_idx;
+      }
+      static_cast<Arc&>(*this) = _idx < _end ? _T->_G->arcFromId(_T->_G->inArc(_idx)) : Arc(lemon::INVALID);
+    }
+    
+    const CompactSubDigraph* _T;
+    int _idx;
+    int _end;
+  };
+
+private:
+  /// Returns whether arc a and both its endpoints are enabled
+  bool isEnabled(int a) const
+  {
+    return _arcs[a] && _nodes[_G->sourceId(a)] && _nodes[_G->targetId(a)];
+  }
+  
+  /// Returns whether out-arc a and its target are enabled
+  bool isOutArcEnabled(int a) const
+  {
+    return _arcs[a] && _nodes[_G->targetId(a)];
+  }
+  
+  /// Returns whether in-arc a and its source are enabled
+  bool isInArcEnabled(int a) const
+  {
+    return _arcs[a] && _nodes[_G->sourceId(a)];
+  }
+  
+  const CompactDigraph* _G;
+  BitSet _nodes;
+  BitSet _arcs;
+};
+
+} // namespace gm
+
+#endif // COMPACTDIGRAPH_H
@@ -9,9 +9,11 @@
 #include "realtensor.h"
 #include "rootedcladisticnoisyancestrygraph.h"
 #include "rootedcladisticnoisyenumeration.h"
+#include "pairwisecompatibility.h"
 #include "bronkerbosch.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
 
 namespace gm {
   
@@ -19,8 +21,12 @@ CompatibilityGraph::CompatibilityGraph(const CharacterMatrix& M)
   : _M(M)
   , _G()
   , _cliqueLimit(-1)
+  , _threads(1)
+  , _validation(false)
   , _nodeToCharStateTree(_G)
   , _charStateTreeToNode()
+  , _nodeToHash(_G)
+  , _cache()
   , _combinations(0)
   , _mapping()
 {
@@ -230,8 +236,10 @@ void CompatibilityGraph::init(const IntPairSet& filter, int size)
     std::cerr << "Searching for maximum cliques ... " << std::endl;
   }
   
-  BronKerbosch bk(_G, _cliqueLimit);
-  bk.run(BronKerbosch::BK_PIVOT_DEGENERACY);
+  // only maximal cliques of maximum size (or of size at least size) are used
+  BronKerbosch bk(_G, _cliqueLimit, _threads);
+  bk.setMinCliqueSize(size);
+  bk.run(BronKerbosch::BK_MAXIMUM);
   bk.sortBySize();
   
   if (g_verbosity >= VERBOSE_ESSENTIAL)
@@ -241,7 +249,7 @@ void CompatibilityGraph::init(const IntPairSet& filter, int size)
     {
       std::cerr << "Size: " << s << "; #maximal cliques: " << bk.getNrCliquesBySize(s) << std::endl;
     }
-    std::cerr << "Total number of maximal cliques: " << bk.getNumberOfMaximalCliques() << std::endl;
+    std::cerr << "Total number of reported maximal cliques: " << bk.getNumberOfMaximalCliques() << std::endl;
   }
   
   NodeMatrix cliques;
@@ -327,9 +335,149 @@ void CompatibilityGraph::initVertices()
   }
 }
   
+void CompatibilityGraph::testPairs(const NodePairVector& pairs,
+                                   boost::atomic<int>& nextPair,
+                                   StlIntVector& compatible,
+                                   StlIntVector& tested) const
+{
+  const int nrPairs = pairs.size();
+  for (int idx = nextPair++; idx < nrPairs; idx = nextPair++)
+  {
+    const IntPair& cs = _nodeToCharStateTree[pairs[idx].first];
+    const IntPair& dt = _nodeToCharStateTree[pairs[idx].second];
+    
+    if (!isCopyTreeCompatible(cs, dt))
+    {
+      compatible[idx] = false;
+      continue;
+    }
+    
+    // the cache is only read here, new entries are added by initEdges.
+    // Validation tests every pair and does not use the cache
+    HashPairBoolMapIt it = _cache.end();
+    if (!_validation)
+    {
+      it = _cache.find(cacheKey(pairs[idx].first, pairs[idx].second));
+    }
+    
+    if (it != _cache.end())
+    {
+      compatible[idx] = it->second;
+    }
+    else
+    {
+      compatible[idx] = isStateTreeCompatible(cs, dt);
+      tested[idx] = true;
+    }
+  }
+}
+  
+CompatibilityGraph::Hash CompatibilityGraph::hash(const IntPair& cs) const
+{
+  typedef std::map<StateGraph::CnaTriple, int> CnaTripleIntMap;
+  
+  const int m = _M.m();
+  const int k = _M.k();
+  const StateTree S = _M.stateTree(cs.second, cs.first);
+  
+  // visit states by their (x,y,z) triple rather than by their index,
+  // as indices change when characters are added to the input
+  CnaTripleIntMap states;
+  for (int i = 0; i < k; ++i)
+  {
+    if (S.isPresent(i))
+    {
+      states[_M.stateToTriple(i)] = i;
+    }
+  }
+  
+  // FNV-1a
+  Hash h = 14695981039346656037ULL;
+  auto combine = [&h](const void* data, size_t size)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t idx = 0; idx < size; ++idx)
+    {
+      h ^= bytes[idx];
+      h *= 1099511628211ULL;
+    }
+  };
+  
+  combine(&m, sizeof(m));
+  for (const auto& state : states)
+  {
+    const int i = state.second;
+    const StateGraph::CnaTriple& triple = state.first;
+    combine(&triple._x, sizeof(triple._x));
+    combine(&triple._y, sizeof(triple._y));
+    combine(&triple._z, sizeof(triple._z));
+    
+    if (i != 0)
+    {
+      const StateGraph::CnaTriple& parentTriple = _M.stateToTriple(S.parent(i));
+      combine(&parentTriple._x, sizeof(parentTriple._x));
+      combine(&parentTriple._y, sizeof(parentTriple._y));
+      combine(&parentTriple._z, sizeof(parentTriple._z));
+    }
+    
+    for (int p = 0; p < m; ++p)
+    {
+      double f_lb = _M.get_f_lb(cs.second, p, cs.first, i);
+      double f_ub = _M.get_f_ub(cs.second, p, cs.first, i);
+      combine(&f_lb, sizeof(f_lb));
+      combine(&f_ub, sizeof(f_ub));
+    }
+  }
+  
+  return h;
+}
+  
+void CompatibilityGraph::readCache(std::istream& in)
+{
+  g_lineNumber = 0;
+  std::string line;
+  
+  int pairCount = -1;
+  gm::getline(in, line);
+  std::stringstream ss(line.c_str());
+  ss >> pairCount;
+  if (pairCount < 0)
+  {
+    throw std::runtime_error(getLineNumber() + "Error: invalid number of pairs");
+  }
+  
+  for (int idx = 0; idx < pairCount; ++idx)
+  {
+    gm::getline(in, line);
+    ss.clear();
+    ss.str(line);
+    
+    Hash h_cs = 0, h_dt = 0;
+    int compatible = -1;
+    ss >> h_cs >> h_dt >> compatible;
+    if (ss.fail() || (compatible != 0 && compatible != 1))
+    {
+      throw std::runtime_error(getLineNumber() + "Error: '" + line
+                               + "' is not a pair of hashes followed by 0 or 1");
+    }
+    
+    _cache[std::make_pair(h_cs, h_dt)] = compatible;
+  }
+}
+  
+void CompatibilityGraph::writeCache(std::ostream& out) const
+{
+  out << _cache.size() << " #pairs" << std::endl;
+  for (const auto& entry : _cache)
+  {
+    out << entry.first.first << " " << entry.first.second << " "
+        << entry.second << std::endl;
+  }
+}
+  
 void CompatibilityGraph::initEdges()
 {
-  int conflict = 0;
+  NodePairVector pairs;
   for (NodeIt v_cs(_G); v_cs != lemon::INVALID; ++v_cs)
   {
     for (NodeIt v_dt(v_cs); v_dt != lemon::INVALID; ++v_dt)
@@ -341,24 +489,74 @@ void CompatibilityGraph::initEdges()
       
       if (cs.first == dt.first) continue;
       
-      if (isCompatible(cs, dt))
+      pairs.push_back(std::make_pair(v_cs, v_dt));
+    }
+  }
+  
+  for (NodeIt v_cs(_G); v_cs != lemon::INVALID; ++v_cs)
+  {
+    _nodeToHash[v_cs] = hash(_nodeToCharStateTree[v_cs]);
+  }
+  
+  // test pairs in parallel, edges are added afterwards in the serial order
+  StlIntVector compatible(pairs.size(), 0);
+  StlIntVector tested(pairs.size(), 0);
+  boost::atomic<int> nextPair(0);
+  if (_threads <= 1)
+  {
+    testPairs(pairs, nextPair, compatible, tested);
+  }
+  else
+  {
+    boost::thread_group threadGroup;
+    for (int i = 0; i < _threads; ++i)
+    {
+      threadGroup.create_thread(boost::bind(&CompatibilityGraph::testPairs, this,
+                                            boost::cref(pairs),
+                                            boost::ref(nextPair),
+                                            boost::ref(compatible),
+                                            boost::ref(tested)));
+    }
+    threadGroup.join_all();
+  }
+  
+  int conflict = 0;
+  int testCount = 0;
+  for (int idx = 0; idx < pairs.size(); ++idx)
+  {
+    Node v_cs = pairs[idx].first;
+    Node v_dt = pairs[idx].second;
+    
+    if (tested[idx])
+    {
+      // validation recomputes every pair, also those in the cache
+      if (!_validation)
       {
-        _G.addEdge(v_cs, v_dt);
+        _cache[cacheKey(v_cs, v_dt)] = compatible[idx];
       }
-      else
+      ++testCount;
+    }
+    
+    if (compatible[idx])
+    {
+      _G.addEdge(v_cs, v_dt);
+    }
+    else
+    {
+      ++conflict;
+      if (g_verbosity >= VERBOSE_DEBUG)
       {
-        ++conflict;
-        if (g_verbosity >= VERBOSE_DEBUG)
-        {
-          std::cerr << "Conflict between (" << cs.first << "," << cs.second
-                    << ") and (" << dt.first << "," << dt.second << ")" << std::endl;
-        }
+        const IntPair& cs = _nodeToCharStateTree[v_cs];
+        const IntPair& dt = _nodeToCharStateTree[v_dt];
+        std::cerr << "Conflict between (" << cs.first << "," << cs.second
+                  << ") and (" << dt.first << "," << dt.second << ")" << std::endl;
       }
     }
   }
   
   if (g_verbosity >= VERBOSE_ESSENTIAL)
   {
+    std::cerr << "Number of state tree pairs tested: " << testCount << " out of " << pairs.size() << std::endl;
     std::cerr << "Number of conflicts detected: " << conflict << std::endl;
     std::cerr << "Compatibility graph has " << lemon::countNodes(_G) << " nodes and " << lemon::countEdges(_G) << " edges" << std::endl;
   }
@@ -396,11 +594,8 @@ void CompatibilityGraph::writeDOT(std::ostream& out) const
   out << "}" << std::endl;
 }
   
-bool CompatibilityGraph::isCompatible(const IntPair& cs, const IntPair& dt) const
+bool CompatibilityGraph::isCopyTreeCompatible(const IntPair& cs, const IntPair& dt) const
 {
-  const int m = _M.m();
-  const int k = _M.k();
-  
   if (!_M.intervals().empty() && _M.interval(cs.first) == _M.interval(dt.first))
   {
     CharacterMatrix::IntPairPairSet C_c = _M.copyTree(cs.second, cs.first);
@@ -413,6 +608,14 @@ bool CompatibilityGraph::isCompatible(const IntPair& cs, const IntPair& dt) cons
     }
   }
   
+  return true;
+}
+  
+bool CompatibilityGraph::isStateTreeCompatible(const IntPair& cs, const IntPair& dt) const
+{
+  const int m = _M.m();
+  const int k = _M.k();
+  
   std::vector<StateTree> S;
   S.push_back(_M.stateTree(cs.second, cs.first));
   S.push_back(_M.stateTree(dt.second, dt.first));
@@ -434,6 +637,28 @@ bool CompatibilityGraph::isCompatible(const IntPair& cs, const IntPair& dt) cons
     }
   }
   
+  PairwiseCompatibility kernel(S[0], S[1], F_lb, F_ub);
+  bool res = kernel.run();
+  
+  if (_validation)
+  {
+    bool refRes = isCompatible(S, F_lb, F_ub);
+    if (res != refRes)
+    {
+      std::cerr << "Warning: compatibility kernel and enumeration disagree on ("
+                << cs.first << "," << cs.second << ") and ("
+                << dt.first << "," << dt.second << ")" << std::endl;
+    }
+    return refRes;
+  }
+  
+  return res;
+}
+  
+bool CompatibilityGraph::isCompatible(const StateTreeVector& S,
+                                      const RealTensor& F_lb,
+                                      const RealTensor& F_ub) const
+{
   RootedCladisticNoisyAncestryGraph G(F_lb, S, F_lb, F_ub);
   G.init();
 //  G.setLabels(F_lb);
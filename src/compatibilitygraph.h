@@ -14,6 +14,7 @@
 #include "solutionset.h"
 #include <map>
 #include <set>
+#include <boost/atomic.hpp>
 
 namespace gm {
   
@@ -45,6 +46,28 @@ public:
     _cliqueLimit = limit;
   }
   
+  int getThreads() const
+  {
+    return _threads;
+  }
+  
+  void setThreads(int threads)
+  {
+    _threads = threads;
+  }
+  
+  bool getValidation() const
+  {
+    return _validation;
+  }
+  
+  /// Cross-check the pairwise compatibility kernel against full enumeration,
+  /// the enumeration result is used. The cache is neither read nor extended
+  void setValidation(bool validation)
+  {
+    _validation = validation;
+  }
+  
   void init(unsigned long combination,
             RealTensor& F,
             StateTreeVector& S,
@@ -57,6 +80,14 @@ public:
   
   void init(std::ifstream& inFile);
   
+  /// Read pairwise compatibilities computed in a previous run; pairs of
+  /// vertices whose characters are unchanged are not tested again
+  void readCache(std::istream& in);
+  
+  /// Write all known pairwise compatibilities, including those that
+  /// were read but not used in this run
+  void writeCache(std::ostream& out) const;
+  
 protected:
   GRAPH_TYPEDEFS(Graph);
   typedef Graph::NodeMap<IntPair> IntPairNodeMap;
@@ -66,19 +97,52 @@ protected:
   typedef NodeVector::const_iterator NodeVectorIt;
   typedef std::vector<NodeVector> NodeMatrix;
   typedef NodeMatrix::const_iterator NodeMatrixIt;
+  typedef std::pair<Node, Node> NodePair;
+  typedef std::vector<NodePair> NodePairVector;
+  
+  /// Content hash of a character and one of its state trees
+  typedef unsigned long long Hash;
+  typedef Graph::NodeMap<Hash> HashNodeMap;
+  typedef std::pair<Hash, Hash> HashPair;
+  typedef std::map<HashPair, bool> HashPairBoolMap;
+  typedef HashPairBoolMap::const_iterator HashPairBoolMapIt;
   
   void initVertices();
   void initEdges();
+  void testPairs(const NodePairVector& pairs,
+                 boost::atomic<int>& nextPair,
+                 StlIntVector& compatible,
+                 StlIntVector& tested) const;
+  
+  /// Hash of the state tree and the frequency intervals of its states,
+  /// which determine the outcome of isStateTreeCompatible, and of the
+  /// method used to decide compatibility
+  Hash hash(const IntPair& cs) const;
+  
+  HashPair cacheKey(Node v_cs, Node v_dt) const
+  {
+    Hash h_cs = _nodeToHash[v_cs];
+    Hash h_dt = _nodeToHash[v_dt];
+    return h_cs < h_dt ? std::make_pair(h_cs, h_dt) : std::make_pair(h_dt, h_cs);
+  }
   
-  bool isCompatible(const IntPair& cs, const IntPair& dt) const;
+  bool isCopyTreeCompatible(const IntPair& cs, const IntPair& dt) const;
+  bool isStateTreeCompatible(const IntPair& cs, const IntPair& dt) const;
+  bool isCompatible(const StateTreeVector& S,
+                    const RealTensor& F_lb,
+                    const RealTensor& F_ub) const;
   void applyFilter(const IntPairSet& filter, const NodeMatrix& cliques);
   
 private:
   const CharacterMatrix& _M;
   Graph _G;
   int _cliqueLimit;
+  int _threads;
+  bool _validation;
   IntPairNodeMap _nodeToCharStateTree;
   NodeMatrix _charStateTreeToNode;
+  HashNodeMap _nodeToHash;
+  HashPairBoolMap _cache;
   
   NodeMatrix _cliques;
   unsigned long _combinations;
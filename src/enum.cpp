@@ -18,9 +18,20 @@
 #include "noisycnaenumerate.h"
 #include "character.h"
 #include "charactermatrix.h"
+#include "solutionstream.h"
+#include "shardedenumerate.h"
+#include "cancellationtoken.h"
+#include "statetreelibrary.h"
+#include "mappedfile.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/thread.hpp>
+#include <unistd.h>
+#include <stdio.h>
 
 using namespace gm;
 
@@ -47,6 +58,34 @@ bool parse_purity_vector(const std::string& purityString,
   return true;
 }
 
+void handle_signal(CancellationToken& cancellation,
+                   boost::asio::signal_set& signals,
+                   const boost::system::error_code& error,
+                   int signalNumber)
+{
+  if (error)
+  {
+    return;
+  }
+  
+  if (cancellation.isCancelled())
+  {
+    // second signal
+    _exit(1);
+  }
+  
+  std::cerr << "Received signal " << signalNumber
+            << ", stopping and writing the solutions found so far"
+            << " (repeat to quit immediately)" << std::endl;
+  cancellation.cancel();
+  
+  signals.async_wait(boost::bind(&handle_signal,
+                                 boost::ref(cancellation),
+                                 boost::ref(signals),
+                                 boost::asio::placeholders::error,
+                                 boost::asio::placeholders::signal_number));
+}
+
 void read_cladistic_tensor(std::ifstream& inFile,
                            RealTensor& F,
                            StateTreeVector& S)
@@ -93,7 +132,7 @@ void enumerate(int limit,
                int timeLimit,
                int threads,
                int state_tree_limit,
-               std::ifstream& inFile,
+               const std::string& inputFilename,
                const std::string& intervalFile,
                int lowerbound,
                bool monoclonal,
@@ -101,16 +140,27 @@ void enumerate(int limit,
                bool writeCliqueFile,
                bool readCliqueFile,
                const std::string& cliqueFile,
+               const std::string& cacheFile,
+               bool validation,
+               const std::string& stateTreeFile,
+               int stateTreeMax,
                int offset,
                const IntSet& whiteList,
+               SolutionStream* stream,
+               bool boundOrdered,
+               const std::string& checkpointFile,
+               int checkpointInterval,
+               bool resume,
+               int workers,
+               const CancellationToken* cancellation,
                SolutionSet& sols)
 {
   CharacterMatrix M;
   
   try
   {
-    g_lineNumber = 0;
-    inFile >> M;
+    MappedFile inputFile(inputFilename);
+    M.read(inputFile.begin(), inputFile.end());
   }
   catch (std::runtime_error& e)
   {
@@ -146,12 +196,60 @@ void enumerate(int limit,
 //    return;
 //  }
   
+  StateTreeLibrary& library = StateTreeLibrary::instance();
+  if (!stateTreeFile.empty())
+  {
+    std::ifstream inStateTreeFile(stateTreeFile.c_str(), std::ios::binary);
+    if (inStateTreeFile.good())
+    {
+      try
+      {
+        library.read(inStateTreeFile);
+      }
+      catch (std::runtime_error& e)
+      {
+        std::cerr << "State tree library file. " << e.what() << std::endl;
+        exit(1);
+      }
+    }
+    else if (stateTreeMax > 0)
+    {
+      if (g_verbosity >= VERBOSE_ESSENTIAL)
+      {
+        std::cerr << "Precomputing state trees up to copy number " << stateTreeMax << " ..." << std::endl;
+      }
+      library.precompute(stateTreeMax, threads);
+    }
+  }
+  
   if (g_verbosity >= VERBOSE_ESSENTIAL)
   {
     std::cerr << "Intializing copy-state matrix ..." << std::endl;
   }
+  M.setThreads(threads);
   M.init();
   
+  if (!stateTreeFile.empty() && library.modified())
+  {
+    // write to a temporary file of this process first, so that concurrent
+    // or interrupted runs never leave an incomplete library
+    const std::string tmpStateTreeFile = stateTreeFile + "." + boost::lexical_cast<std::string>(getpid()) + ".tmp";
+    bool written = false;
+    {
+      std::ofstream outStateTreeFile(tmpStateTreeFile.c_str(), std::ios::binary);
+      if (outStateTreeFile.good())
+      {
+        library.write(outStateTreeFile);
+        written = outStateTreeFile.good();
+      }
+    }
+    
+    if (!written || rename(tmpStateTreeFile.c_str(), stateTreeFile.c_str()) != 0)
+    {
+      std::cerr << "Unable to write state tree library file '" << stateTreeFile << "'" << std::endl;
+    }
+  }
+  
   if (monoclonal)
   {
     M.applyHeuristic();
@@ -165,7 +263,40 @@ void enumerate(int limit,
       std::cerr << std::endl << "Initializing compatibility graph ..." << std::endl;
     }
     pComp = new CompatibilityGraph(M);
+    pComp->setThreads(threads);
+    pComp->setValidation(validation);
+    
+    if (!cacheFile.empty())
+    {
+      std::ifstream inCacheFile(cacheFile.c_str());
+      if (inCacheFile.good())
+      {
+        try
+        {
+          pComp->readCache(inCacheFile);
+        }
+        catch (std::runtime_error& e)
+        {
+          std::cerr << "Compatibility cache file. " << e.what() << std::endl;
+          exit(1);
+        }
+      }
+    }
+    
     pComp->init(IntPairSet(), -1);
+    
+    if (!cacheFile.empty())
+    {
+      std::ofstream outCacheFile(cacheFile.c_str());
+      if (outCacheFile.good())
+      {
+        pComp->writeCache(outCacheFile);
+      }
+      if (!outCacheFile.good())
+      {
+        std::cerr << "Unable to write compatibility cache '" << cacheFile << "'" << std::endl;
+      }
+    }
   }
   else
   {
@@ -183,8 +314,58 @@ void enumerate(int limit,
     }
   }
   
+  if (workers > 0)
+  {
+    ShardedEnumerate alg(M, purityValues, *pComp, lowerbound);
+    alg.setBoundOrdered(boundOrdered);
+    alg.setCancellationToken(cancellation);
+    try
+    {
+      alg.enumerate(workers, limit, timeLimit, threads, state_tree_limit, monoclonal, offset, whiteList);
+    }
+    catch (std::runtime_error& e)
+    {
+      std::cerr << "Workers. " << e.what() << std::endl;
+      exit(1);
+    }
+    
+    sols = alg.sols();
+    delete pComp;
+    
+    if (g_verbosity >= VERBOSE_ESSENTIAL)
+    {
+      std::cerr << "Generated " << sols.solutionCount() << " solutions" << std::endl;
+    }
+    return;
+  }
+  
   NoisyCnaEnumerate alg(M, purityValues, *pComp, lowerbound);
   alg.init(state_tree_limit);
+  alg.setSolutionStream(stream);
+  alg.setBoundOrdered(boundOrdered);
+  alg.setCancellationToken(cancellation);
+  if (!checkpointFile.empty())
+  {
+    alg.setCheckpoint(checkpointFile, checkpointInterval);
+  }
+  if (resume)
+  {
+    std::ifstream inCheckpointFile(checkpointFile.c_str());
+    if (!inCheckpointFile.good())
+    {
+      std::cerr << "Unable to open '" << checkpointFile << "' for reading" << std::endl;
+      exit(1);
+    }
+    try
+    {
+      alg.readCheckpoint(inCheckpointFile);
+    }
+    catch (std::runtime_error& e)
+    {
+      std::cerr << "Checkpoint file. " << e.what() << std::endl;
+      exit(1);
+    }
+  }
   alg.enumerate(limit, timeLimit, threads, state_tree_limit, monoclonal, offset, whiteList);
 
   sols = alg.sols();
@@ -192,9 +373,8 @@ void enumerate(int limit,
   
   if (g_verbosity >= VERBOSE_ESSENTIAL)
   {
-    std::cerr << "Generated " << sols.solutionCount() << " solutions" << std::endl;
+    std::cerr << "Generated " << (stream ? stream->solutionCount() : sols.solutionCount()) << " solutions" << std::endl;
   }
-  inFile.close();
 }
 
 int main(int argc, char** argv)
@@ -206,12 +386,22 @@ int main(int argc, char** argv)
   int random_seed = 0;
   int lowerbound = 0;
   bool polyclonal = false;
+  bool boundOrdered = false;
+  std::string checkpointFile;
+  int checkpointInterval = 600;
+  int workers = 0;
   bool perfectData = false;
   std::string purityString;
   std::string cliqueFile;
+  std::string cacheFile;
+  bool validation = false;
+  std::string stateTreeFile;
+  int stateTreeMax = -1;
   int offset = 0;
   int verbosityLevel = 1;
   std::string whiteListString;
+  std::string streamFile;
+  bool streamDuplicates = false;
   
   lemon::ArgParser ap(argc, argv);
   ap.boolOption("-version", "Show version number")
@@ -220,6 +410,10 @@ int main(int argc, char** argv)
     .refOption("p", "Polyclonal", polyclonal)
     .refOption("purity", "Purity values (used for fixing trunk)",  purityString)
     .refOption("clique", "Clique file", cliqueFile)
+    .refOption("cache", "Compatibility cache file, created if it does not exist", cacheFile)
+    .refOption("validate", "Cross-check compatibility kernel against enumeration, the enumeration result is used", validation)
+    .refOption("statetrees", "State tree library file, created if it does not exist and updated with the state trees enumerated in this run", stateTreeFile)
+    .refOption("stmax", "Maximum copy number, at most 3, of the state trees precomputed when creating the -statetrees file (default: -1, only those of the input)", stateTreeMax)
     .refOption("perfect", "Perfect data mode", perfectData)
     .refOption("t", "Number of threads (default: 2)", threads)
     .refOption("l", "Maximum number of trees to enumerate (default: -1)", limit)
@@ -229,6 +423,13 @@ int main(int argc, char** argv)
     .refOption("r", "Seed for random number generator", random_seed)
     .refOption("lb", "Lower bound on #characters in enumerated trees (default: 0)", lowerbound)
     .refOption("w", "Characters that must be present in the solution trees", whiteListString)
+    .refOption("stream", "Write solutions to this file as soon as they are found, rather than to standard output at the end. To write each tree once, every written tree of the largest size is kept in memory (16 bytes per arc plus hash set overhead), see -dup", streamFile)
+    .refOption("dup", "With -stream, do not remove duplicate trees, so that memory use does not grow with the number of trees written", streamDuplicates)
+    .refOption("checkpoint", "Write progress to this file periodically, see --resume", checkpointFile)
+    .refOption("ci", "Checkpoint interval in seconds (default: 600)", checkpointInterval)
+    .boolOption("-resume", "Continue from the file given by -checkpoint, the other options must be the same as in the interrupted run")
+    .refOption("workers", "Number of worker processes that enumerate the clique combinations, -t then gives the number of threads per worker (default: 0, no workers)", workers)
+    .refOption("bo", "Bound-ordered exploration: branch first on the arcs that leave the largest upper bound, finds the largest trees earlier", boundOrdered)
     .other("input_1", "Input file")
     .other("input_2", "Interval file relating SNVs affected by the same CNA");
   ap.parse();
@@ -255,6 +456,7 @@ int main(int argc, char** argv)
               << "' for reading" << std::endl;
     return 1;
   }
+  inFile.close();
   
   IntSet whiteList;
   if (!whiteListString.empty())
@@ -278,9 +480,69 @@ int main(int argc, char** argv)
     writeCliqueFile = true;
   }
   
+  if (stateTreeMax > StateTreeLibrary::MAX_PRECOMPUTE_X)
+  {
+    std::cerr << "Error: -stmax should be at most " << StateTreeLibrary::MAX_PRECOMPUTE_X << std::endl;
+    return 1;
+  }
+  
+  const bool resume = ap.given("-resume");
+  if (resume && checkpointFile.empty())
+  {
+    std::cerr << "Error: --resume requires -checkpoint" << std::endl;
+    return 1;
+  }
+  if (!checkpointFile.empty() && !streamFile.empty())
+  {
+    std::cerr << "Error: -checkpoint cannot be combined with -stream" << std::endl;
+    return 1;
+  }
+  if (streamDuplicates && streamFile.empty())
+  {
+    std::cerr << "Error: -dup requires -stream" << std::endl;
+    return 1;
+  }
+  if (!checkpointFile.empty() && checkpointInterval <= 0)
+  {
+    std::cerr << "Error: checkpoint interval should be positive" << std::endl;
+    return 1;
+  }
+  
+  if (workers > 0 && (!checkpointFile.empty() || !streamFile.empty()))
+  {
+    std::cerr << "Error: -workers cannot be combined with -checkpoint or -stream" << std::endl;
+    return 1;
+  }
+  
+  SolutionStream* pStream = NULL;
+  if (!streamFile.empty())
+  {
+    try
+    {
+      pStream = new SolutionStream(streamFile, !streamDuplicates);
+    }
+    catch (std::runtime_error& e)
+    {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+  }
+  
+  // on SIGINT or SIGTERM the enumeration stops, the largest trees found so
+  // far are written as usual
+  CancellationToken cancellation;
+  boost::asio::io_service ioService;
+  boost::asio::signal_set signals(ioService, SIGINT, SIGTERM);
+  signals.async_wait(boost::bind(&handle_signal,
+                                 boost::ref(cancellation),
+                                 boost::ref(signals),
+                                 boost::asio::placeholders::error,
+                                 boost::asio::placeholders::signal_number));
+  boost::thread signalThread([&ioService]() { ioService.run(); });
+  
   SolutionSet sols;
   enumerate(limit, timeLimit, threads,
-            state_tree_limit, inFile,
+            state_tree_limit, ap.files()[0],
             (ap.files().size() > 1 ? ap.files()[1] : ""),
             lowerbound,
             !polyclonal,
@@ -288,10 +550,32 @@ int main(int argc, char** argv)
             writeCliqueFile,
             readCliqueFile,
             cliqueFile,
+            cacheFile,
+            validation,
+            stateTreeFile,
+            stateTreeMax,
             offset,
             whiteList,
+            pStream,
+            boundOrdered,
+            checkpointFile,
+            checkpointInterval,
+            resume,
+            workers,
+            &cancellation,
             sols);
-  std::cout << sols;
+  
+  ioService.stop();
+  signalThread.join();
+  
+  if (pStream)
+  {
+    delete pStream;
+  }
+  else
+  {
+    std::cout << sols;
+  }
   
   return 0;
 }
@@ -0,0 +1,186 @@
+/*
+ * frontierstack.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef FRONTIERSTACK_H
+#define FRONTIERSTACK_H
+
+#include "utils.h"
+
+namespace gm {
+
+/// Frontiers of the search nodes on the current search path
+///
+/// All frontiers are stored consecutively in a single array, with the
+/// frontier of the current search node on top. Arcs removed from the back
+/// of the current frontier stay in place until restore() is called, and a
+/// child frontier starts after them. Once the array has grown to the
+/// largest size needed, pushing and popping frontiers does not allocate.
+class FrontierStack
+{
+public:
+  typedef Digraph::Arc Arc;
+  typedef std::vector<Arc> ArcVector;
+  
+  FrontierStack()
+    : _arcs()
+    , _frames()
+  {
+  }
+  
+  /// Pushes the frontier consisting of the arcs in [first, last)
+  template<typename ArcIterator>
+  void push(ArcIterator first, ArcIterator last)
+  {
+    Frame frame;
+    frame._begin = frame._end = _arcs.size();
+    for (; first != last; ++first)
+    {
+      _arcs.push_back(*first);
+      ++frame._end;
+    }
+    frame._size = frame._end - frame._begin;
+    _frames.push_back(frame);
+  }
+  
+  /// Pushes a copy of the current frontier
+  void push()
+  {
+    assert(!_frames.empty());
+    const size_t parentBegin = _frames.back()._begin;
+    
+    Frame frame;
+    frame._begin = _arcs.size();
+    frame._size = _frames.back()._size;
+    frame._end = frame._begin + frame._size;
+    
+    _arcs.resize(frame._end);
+    std::copy(_arcs.begin() + parentBegin,
+              _arcs.begin() + parentBegin + frame._size,
+              _arcs.begin() + frame._begin);
+    _frames.push_back(frame);
+  }
+  
+  /// Pops the current frontier
+  void pop()
+  {
+    assert(!_frames.empty());
+    _arcs.resize(_frames.back()._begin);
+    _frames.pop_back();
+  }
+  
+  bool empty() const
+  {
+    return _frames.back()._size == 0;
+  }
+  
+  size_t size() const
+  {
+    return _frames.back()._size;
+  }
+  
+  Arc& operator[](size_t idx)
+  {
+    assert(idx < size());
+    return _arcs[_frames.back()._begin + idx];
+  }
+  
+  Arc operator[](size_t idx) const
+  {
+    assert(idx < size());
+    return _arcs[_frames.back()._begin + idx];
+  }
+  
+  Arc back() const
+  {
+    return (*this)[size() - 1];
+  }
+  
+  Arc* begin()
+  {
+    return _arcs.data() + _frames.back()._begin;
+  }
+  
+  Arc* end()
+  {
+    return begin() + size();
+  }
+  
+  const Arc* begin() const
+  {
+    return _arcs.data() + _frames.back()._begin;
+  }
+  
+  const Arc* end() const
+  {
+    return begin() + size();
+  }
+  
+  /// Arcs removed by pop_back() since the last restore(), in reverse order
+  /// of removal, are [end(), removedEnd())
+  const Arc* removedEnd() const
+  {
+    return _arcs.data() + _frames.back()._end;
+  }
+  
+  /// Appends arc a to the current frontier, which must not have removed arcs
+  void push_back(Arc a)
+  {
+    Frame& frame = _frames.back();
+    assert(frame._end == _arcs.size());
+    assert(frame._begin + frame._size == frame._end);
+    
+    _arcs.push_back(a);
+    ++frame._size;
+    ++frame._end;
+  }
+  
+  /// Removes the last arc of the current frontier
+  void pop_back()
+  {
+    assert(!empty());
+    --_frames.back()._size;
+  }
+  
+  /// Shrinks the current frontier, which must not have removed arcs,
+  /// to its first size arcs
+  void resize(size_t size)
+  {
+    Frame& frame = _frames.back();
+    assert(frame._begin + frame._size == frame._end);
+    assert(size <= frame._size);
+    
+    frame._size = size;
+    frame._end = frame._begin + size;
+    _arcs.resize(frame._end);
+  }
+  
+  /// Puts back the arcs removed by pop_back() in their original order
+  void restore()
+  {
+    Frame& frame = _frames.back();
+    frame._size = frame._end - frame._begin;
+  }
+
+private:
+  struct Frame
+  {
+    /// Position of the first arc of the frontier
+    size_t _begin;
+    /// Number of arcs in the frontier
+    size_t _size;
+    /// Position past the last arc of the frontier, including removed arcs
+    size_t _end;
+  };
+  
+  typedef std::vector<Frame> FrameVector;
+  
+  ArcVector _arcs;
+  FrameVector _frames;
+};
+
+} // namespace gm
+
+#endif // FRONTIERSTACK_H
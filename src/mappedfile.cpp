@@ -0,0 +1,63 @@
+/*
+ * mappedfile.cpp
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#include "mappedfile.h"
+#include <stdexcept>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace gm {
+
+MappedFile::MappedFile(const std::string& filename)
+  : _data(NULL)
+  , _size(0)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+  {
+    throw std::runtime_error("Error: unable to open '" + filename + "': " + strerror(errno));
+  }
+  
+  struct stat st;
+  if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+  {
+    close(fd);
+    throw std::runtime_error("Error: '" + filename + "' is not a regular file");
+  }
+  
+  // a mapping cannot be empty
+  _size = st.st_size;
+  if (_size > 0)
+  {
+    void* data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      int error = errno;
+      close(fd);
+      throw std::runtime_error("Error: unable to map '" + filename + "': " + strerror(error));
+    }
+    
+    // the file is read once from front to back
+    madvise(data, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const char*>(data);
+  }
+  
+  close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  if (_data)
+  {
+    munmap(const_cast<char*>(_data), _size);
+  }
+}
+
+} // namespace gm
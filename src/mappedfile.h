@@ -0,0 +1,56 @@
+/*
+ * mappedfile.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <stddef.h>
+
+namespace gm {
+
+/// Read-only view of the contents of a file
+///
+/// The file is mapped into memory, so that it can be parsed in place
+/// without copying it into a stream buffer first. The view remains valid
+/// until the object is destroyed.
+class MappedFile
+{
+public:
+  /// Maps filename, throws std::runtime_error if the file cannot be opened
+  /// or mapped
+  MappedFile(const std::string& filename);
+  
+  ~MappedFile();
+  
+  const char* begin() const
+  {
+    return _data;
+  }
+  
+  const char* end() const
+  {
+    return _data + _size;
+  }
+  
+  size_t size() const
+  {
+    return _size;
+  }
+
+private:
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+private:
+  /// NULL if the file is empty
+  const char* _data;
+  size_t _size;
+};
+
+} // namespace gm
+
+#endif // MAPPEDFILE_H
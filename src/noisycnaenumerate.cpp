@@ -8,6 +8,10 @@
 #include "noisycnaenumerate.h"
 #include "realtensor.h"
 #include "rootedcladisticnoisyenumeration.h"
+#include <boost/thread.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <fstream>
+#include <sstream>
 #include <stdio.h>
 
 namespace gm {
@@ -20,7 +24,21 @@ NoisyCnaEnumerate::NoisyCnaEnumerate(const CharacterMatrix& M,
   , _purityValues(purityValues)
   , _comp(comp)
   , _sols()
+  , _solutionStream(NULL)
+  , _boundOrdered(false)
+  , _cancellationToken(NULL)
+  , _trees()
   , _treeSize(lowerbound)
+  , _treeSizeBound(lowerbound)
+  , _mutex()
+  , _checkpointFile()
+  , _checkpointInterval(-1)
+  , _completedCombinations()
+  , _solTrees()
+  , _solCombinations()
+  , _runningEnumerations()
+  , _progress()
+  , _resumed(false)
   , _combinations(-1)
   , _real_n(-1)
 {
@@ -45,25 +63,112 @@ void NoisyCnaEnumerate::enumerate(int limit,
 {
   const int n = _M.n();
   
-  _sols.clear();
+  if (!_resumed)
+  {
+    _sols.clear();
+    _trees.clear();
+    _solTrees.clear();
+    _solCombinations.clear();
+  }
+  
+  boost::thread checkpointThread;
+  if (!_checkpointFile.empty())
+  {
+    checkpointThread = boost::thread(&NoisyCnaEnumerate::checkpointWorker, this);
+  }
   
   StlIntVector pi(n, 0);
   pi[0] = offset;
-  int count = 0;
+  
+  StlIntMatrix combinations;
   do {
-    if (g_verbosity >= VERBOSE_ESSENTIAL)
+    combinations.push_back(pi);
+  } while (next(state_tree_limit, offset, pi));
+  
+  const int nrCombinations = combinations.size();
+  if (threads <= 1 || nrCombinations == 1)
+  {
+    for (int count = 0; count < nrCombinations && !cancelled(); ++count)
     {
-      if (state_tree_limit != -1)
-      {
-        std::cerr << std::endl << "State tree combination " << ++count << "/" << state_tree_limit << " ..." << std::endl;
-      }
-      else
-      {
-        std::cerr << std::endl << "State tree combination " << ++count << "/" << _combinations << " ..." << std::endl;
-      }
+      if (isCompleted(combinations[count][0]))
+        continue;
+      
+      reportCombination(count, state_tree_limit);
+      solve(combinations[count], limit, timeLimit, threads, state_tree_limit, monoclonal, whiteList);
     }
-    solve(pi, limit, timeLimit, threads, state_tree_limit, monoclonal, whiteList);
-  } while (next(state_tree_limit, offset, pi));
+  }
+  else
+  {
+    // solve several combinations at once, the remaining threads
+    // are used by the enumeration of each combination
+    const int workers = std::min(threads, nrCombinations);
+    const int threadsPerWorker = std::max(1, threads / workers);
+    
+    boost::atomic<int> nextCombination(0);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < workers; ++i)
+    {
+      threadGroup.create_thread(boost::bind(&NoisyCnaEnumerate::solveWorker, this,
+                                            boost::cref(combinations),
+                                            boost::ref(nextCombination),
+                                            limit, timeLimit,
+                                            threadsPerWorker,
+                                            state_tree_limit,
+                                            monoclonal,
+                                            boost::cref(whiteList)));
+    }
+    threadGroup.join_all();
+  }
+  
+  if (!_solutionStream)
+  {
+    removeDuplicates();
+  }
+  
+  if (!_checkpointFile.empty())
+  {
+    checkpointThread.interrupt();
+    checkpointThread.join();
+    saveCheckpoint();
+  }
+}
+  
+void NoisyCnaEnumerate::solveWorker(const StlIntMatrix& combinations,
+                                    boost::atomic<int>& nextCombination,
+                                    int limit,
+                                    int timeLimit,
+                                    int threads,
+                                    int state_tree_limit,
+                                    bool monoclonal,
+                                    const IntSet& whiteList)
+{
+  const int nrCombinations = combinations.size();
+  for (int count = nextCombination++; count < nrCombinations && !cancelled(); count = nextCombination++)
+  {
+    if (isCompleted(combinations[count][0]))
+      continue;
+    
+    {
+      boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+      reportCombination(count, state_tree_limit);
+    }
+    solve(combinations[count], limit, timeLimit, threads, state_tree_limit, monoclonal, whiteList);
+  }
+}
+  
+void NoisyCnaEnumerate::reportCombination(int count, int state_tree_limit)
+{
+  if (g_verbosity >= VERBOSE_ESSENTIAL)
+  {
+    if (state_tree_limit != -1)
+    {
+      std::cerr << std::endl << "State tree combination " << count + 1 << "/" << state_tree_limit << " ..." << std::endl;
+    }
+    else
+    {
+      std::cerr << std::endl << "State tree combination " << count + 1 << "/" << _combinations << " ..." << std::endl;
+    }
+  }
 }
   
 bool NoisyCnaEnumerate::next(int state_tree_limit,
@@ -160,9 +265,11 @@ void NoisyCnaEnumerate::fixTrunk(const RealTensor& F_ub,
   
   typedef std::set<IntPair> IntPairSet;
   
+  // combinations are solved concurrently, the report is written at once
+  std::ostringstream out;
   if (g_verbosity >= VERBOSE_ESSENTIAL)
   {
-    std::cerr << "Truncal characters (CCF_lb >= 1, across all samples):" << std::endl;
+    out << "Truncal characters (CCF_lb >= 1, across all samples):" << std::endl;
   }
   
   IntPairSet truncalCharacters;
@@ -170,9 +277,9 @@ void NoisyCnaEnumerate::fixTrunk(const RealTensor& F_ub,
   {
     if (g_verbosity >= VERBOSE_ESSENTIAL)
     {
-      std::cerr << "Character " << _M(0, mapNewCharToOldChar[c]).characterLabel() << " (" << mapNewCharToOldChar[c] << ") : ";
-      S[c].writeEdgeList(std::cerr);
-      std::cerr << std::endl;
+      out << "Character " << _M(0, mapNewCharToOldChar[c]).characterLabel() << " (" << mapNewCharToOldChar[c] << ") : ";
+      S[c].writeEdgeList(out);
+      out << std::endl;
     }
     
     bool truncal = true;
@@ -220,13 +327,16 @@ void NoisyCnaEnumerate::fixTrunk(const RealTensor& F_ub,
   
   if (g_verbosity >= VERBOSE_ESSENTIAL)
   {
-    std::cerr << "Truncal character-state pairs:" << std::endl;
+    out << "Truncal character-state pairs:" << std::endl;
     for (auto ci : truncalCharacters)
     {
       auto xyz = _M.stateToTriple(ci.second);
-      std::cerr << _M(0, mapNewCharToOldChar[ci.first]).characterLabel()
-                << " , (" << xyz._x << "," << xyz._y << "," << xyz._z << ")" << std::endl;
+      out << _M(0, mapNewCharToOldChar[ci.first]).characterLabel()
+          << " , (" << xyz._x << "," << xyz._y << "," << xyz._z << ")" << std::endl;
     }
+    
+    boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+    std::cerr << out.str();
   }
   
   Digraph::Node monoClonalRoot = G.collapse(truncalCharacters);
@@ -274,20 +384,65 @@ void NoisyCnaEnumerate::solve(const StlIntVector& pi,
                                             limit,
                                             timeLimit,
                                             threads,
-                                            _treeSize,
+                                            _treeSizeBound,
                                             monoclonal,
                                             monoclonal && !_purityValues.empty(),
                                             remappedWhiteList);
+  enumerate.setSharedLowerbound(&_treeSizeBound);
+  enumerate.setSharedTrees(&_trees, mapNewCharToOldChar, pi[0]);
+  enumerate.setSolutionStream(_solutionStream);
+  enumerate.setBoundOrdered(_boundOrdered);
+  enumerate.setCancellationToken(_cancellationToken);
+  
+  if (!_checkpointFile.empty())
+  {
+    enumerate.setCheckpointing(true);
+    
+    boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+    auto it = _progress.find(pi[0]);
+    if (it != _progress.end())
+    {
+      enumerate.setProgress(it->second);
+      _progress.erase(it);
+    }
+    _runningEnumerations[pi[0]] = &enumerate;
+  }
+  
   enumerate.run();
   
+  boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
   if (enumerate.objectiveValue() >= _treeSize)
   {
     if (enumerate.objectiveValue() > _treeSize)
     {
       _sols.clear();
+      _solTrees.clear();
+      _solCombinations.clear();
       _treeSize = enumerate.objectiveValue();
     }
-    enumerate.populateSolutionSet(_sols);
+    if (!_solutionStream)
+    {
+      // in the same order as the solutions
+      enumerate.populateSolutionSet(_sols);
+      std::vector<TreeHashSet::CanonicalTree> trees;
+      enumerate.canonicalTrees(trees);
+      _solTrees.insert(_solTrees.end(), trees.begin(), trees.end());
+      _solCombinations.insert(_solCombinations.end(), trees.size(), pi[0]);
+    }
+  }
+  if (!_checkpointFile.empty())
+  {
+    // a stopped combination is continued when resuming, its finished root
+    // tasks and trees found so far are kept in the checkpoint
+    if (enumerate.cancelled())
+    {
+      enumerate.getProgress(_progress[pi[0]]);
+    }
+    else
+    {
+      _completedCombinations.insert(pi[0]);
+    }
+    _runningEnumerations.erase(pi[0]);
   }
   
   if (g_verbosity >= VERBOSE_ESSENTIAL)
@@ -301,6 +456,297 @@ void NoisyCnaEnumerate::solve(const StlIntVector& pi,
   }
 }
   
+bool NoisyCnaEnumerate::isCompleted(int combination) const
+{
+  boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+  return _completedCombinations.count(combination) > 0;
+}
+  
+void NoisyCnaEnumerate::removeDuplicates()
+{
+  assert(_solTrees.size() == _sols.solutionCount());
+  assert(_solCombinations.size() == _sols.solutionCount());
+  
+  SolutionSet sols;
+  std::vector<TreeHashSet::CanonicalTree> solTrees;
+  StlIntVector solCombinations;
+  for (int idx = 0; idx < _sols.solutionCount(); ++idx)
+  {
+    // the owner is the lowest combination in which the tree was found
+    int owner = _trees.owner(_solTrees[idx]);
+    if (owner == -1 || owner == _solCombinations[idx])
+    {
+      sols.add(_sols.solution(idx));
+      solTrees.push_back(_solTrees[idx]);
+      solCombinations.push_back(_solCombinations[idx]);
+    }
+  }
+  
+  boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+  std::swap(_sols, sols);
+  std::swap(_solTrees, solTrees);
+  std::swap(_solCombinations, solCombinations);
+}
+  
+void NoisyCnaEnumerate::checkpointWorker()
+{
+  try
+  {
+    while (true)
+    {
+      boost::this_thread::sleep(boost::posix_time::seconds(_checkpointInterval));
+      saveCheckpoint();
+    }
+  }
+  catch (boost::thread_interrupted&)
+  {
+  }
+}
+  
+void NoisyCnaEnumerate::saveCheckpoint() const
+{
+  // write to a temporary file first, a checkpoint is never left incomplete
+  const std::string tmpFile = _checkpointFile + ".tmp";
+  {
+    std::ofstream out(tmpFile.c_str());
+    if (!out.good())
+    {
+      std::cerr << "Unable to open '" << tmpFile << "' for writing" << std::endl;
+      return;
+    }
+    writeCheckpoint(out);
+  }
+  
+  if (rename(tmpFile.c_str(), _checkpointFile.c_str()) != 0)
+  {
+    std::cerr << "Unable to write checkpoint '" << _checkpointFile << "'" << std::endl;
+  }
+}
+  
+void NoisyCnaEnumerate::writeCheckpoint(std::ostream& out) const
+{
+  // copy the state, so that the enumerations are not held up while writing
+  int treeSize = -1;
+  IntSet completedCombinations;
+  std::vector<TreeHashSet::CanonicalTree> solTrees;
+  StlIntVector solCombinations;
+  SolutionSet sols;
+  std::map<int, RootedCladisticEnumeration::Progress> progress;
+  {
+    boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+    
+    treeSize = _treeSize;
+    completedCombinations = _completedCombinations;
+    solTrees = _solTrees;
+    solCombinations = _solCombinations;
+    sols = _sols;
+    
+    // the progress of the combinations that are not resumed yet is kept
+    progress = _progress;
+    for (const auto& entry : _runningEnumerations)
+    {
+      entry.second->getProgress(progress[entry.first]);
+    }
+  }
+  
+  out << _M.n() << " #characters" << std::endl;
+  out << _combinations << " #combinations" << std::endl;
+  out << treeSize << " #tree size" << std::endl;
+  
+  out << completedCombinations.size() << " #completed combinations" << std::endl;
+  bool first = true;
+  for (int combination : completedCombinations)
+  {
+    if (first)
+      first = false;
+    else
+      out << " ";
+    out << combination;
+  }
+  out << std::endl;
+  
+  // the trees of combinations that are not completed are in their progress
+  StlIntVector solIndices;
+  for (int idx = 0; idx < solTrees.size(); ++idx)
+  {
+    if (completedCombinations.count(solCombinations[idx]))
+    {
+      solIndices.push_back(idx);
+    }
+  }
+  
+  out << solIndices.size() << " #trees" << std::endl;
+  for (int idx : solIndices)
+  {
+    out << solCombinations[idx];
+    for (const TreeHashSet::CharStateArc& arc : solTrees[idx])
+    {
+      out << " " << arc.first.first << " " << arc.first.second << " "
+          << arc.second.first << " " << arc.second.second;
+    }
+    out << std::endl;
+  }
+  
+  out << solIndices.size() << " #solutions" << std::endl;
+  for (int idx : solIndices)
+  {
+    out << sols.solution(idx);
+  }
+  
+  out << progress.size() << " #running combinations" << std::endl;
+  for (const auto& entry : progress)
+  {
+    out << entry.first << " #combination" << std::endl;
+    out << entry.second;
+  }
+}
+  
+void NoisyCnaEnumerate::readCheckpoint(std::istream& in)
+{
+  g_lineNumber = 0;
+  std::string line;
+  
+  int n = -1;
+  gm::getline(in, line);
+  std::stringstream ss(line);
+  ss >> n;
+  
+  long combinations = -1;
+  gm::getline(in, line);
+  ss.clear();
+  ss.str(line);
+  ss >> combinations;
+  if (n != _M.n() || combinations != static_cast<long>(_combinations))
+  {
+    throw std::runtime_error(getLineNumber() + "Error: checkpoint does not match the input");
+  }
+  
+  int treeSize = -1;
+  gm::getline(in, line);
+  ss.clear();
+  ss.str(line);
+  ss >> treeSize;
+  if (treeSize < 0)
+  {
+    throw std::runtime_error(getLineNumber() + "Error: invalid tree size");
+  }
+  
+  int count = -1;
+  gm::getline(in, line);
+  ss.clear();
+  ss.str(line);
+  ss >> count;
+  if (count < 0)
+  {
+    throw std::runtime_error(getLineNumber() + "Error: invalid number of completed combinations");
+  }
+  
+  gm::getline(in, line);
+  ss.clear();
+  ss.str(line);
+  _completedCombinations.clear();
+  for (int idx = 0; idx < count; ++idx)
+  {
+    int combination = -1;
+    if (!(ss >> combination) || combination < 0)
+    {
+      throw std::runtime_error(getLineNumber() + "Error: '" + line
+                               + "' is not a list of combinations");
+    }
+    _completedCombinations.insert(combination);
+  }
+  
+  gm::getline(in, line);
+  ss.clear();
+  ss.str(line);
+  ss >> count;
+  if (count < 0)
+  {
+    throw std::runtime_error(getLineNumber() + "Error: invalid number of trees");
+  }
+  
+  _trees.clear();
+  _solTrees.assign(count, TreeHashSet::CanonicalTree());
+  _solCombinations.assign(count, -1);
+  for (int idx = 0; idx < count; ++idx)
+  {
+    gm::getline(in, line);
+    ss.clear();
+    ss.str(line);
+    
+    if (!(ss >> _solCombinations[idx]) || _solCombinations[idx] < 0)
+    {
+      throw std::runtime_error(getLineNumber() + "Error: '" + line
+                               + "' does not start with a combination");
+    }
+    
+    TreeHashSet::CharStateArc arc;
+    while (ss >> arc.first.first >> arc.first.second >> arc.second.first >> arc.second.second)
+    {
+      _solTrees[idx].push_back(arc);
+    }
+    if (!ss.eof() || _solTrees[idx].empty()
+        || !std::is_sorted(_solTrees[idx].begin(), _solTrees[idx].end()))
+    {
+      throw std::runtime_error(getLineNumber() + "Error: '" + line
+                               + "' is not a sorted list of (char,state) parent/child pairs");
+    }
+    _trees.insert(_solTrees[idx], treeSize, _solCombinations[idx]);
+  }
+  
+  gm::getline(in, line);
+  ss.clear();
+  ss.str(line);
+  ss >> count;
+  if (count < 0)
+  {
+    throw std::runtime_error(getLineNumber() + "Error: invalid number of solutions");
+  }
+  
+  if (count != _solTrees.size())
+  {
+    throw std::runtime_error(getLineNumber() + "Error: number of solutions and trees differ");
+  }
+  
+  _sols.clear();
+  for (int idx = 0; idx < count; ++idx)
+  {
+    Solution sol;
+    in >> sol;
+    _sols.add(sol);
+    
+    gm::getline(in, line);
+  }
+  
+  gm::getline(in, line);
+  ss.clear();
+  ss.str(line);
+  ss >> count;
+  if (count < 0)
+  {
+    throw std::runtime_error(getLineNumber() + "Error: invalid number of running combinations");
+  }
+  
+  _progress.clear();
+  for (int idx = 0; idx < count; ++idx)
+  {
+    int combination = -1;
+    gm::getline(in, line);
+    ss.clear();
+    ss.str(line);
+    ss >> combination;
+    if (combination < 0)
+    {
+      throw std::runtime_error(getLineNumber() + "Error: invalid combination");
+    }
+    in >> _progress[combination];
+  }
+  
+  _treeSize = treeSize;
+  _treeSizeBound = std::max(_treeSizeBound.load(), treeSize);
+  _resumed = true;
+}
+  
 void NoisyCnaEnumerate::get(int state_tree_limit,
                             int combination,
                             RealTensor& F,
@@ -12,6 +12,12 @@
 #include "solutionset.h"
 #include "compatibilitygraph.h"
 #include "rootedcladisticnoisyancestrygraph.h"
+#include "solutionstream.h"
+#include "treehashset.h"
+#include "rootedcladisticenumeration.h"
+#include "cancellationtoken.h"
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace gm {
   
@@ -43,6 +49,61 @@ public:
     return _sols;
   }
   
+  /// Tree size of the solutions in sols()
+  int treeSize() const
+  {
+    return _treeSize;
+  }
+  
+  /// Write solutions to stream as soon as they are found,
+  /// sols() then remains empty
+  void setSolutionStream(SolutionStream* stream)
+  {
+    _solutionStream = stream;
+  }
+  
+  /// Branch first on the arcs that leave the largest upper bound
+  void setBoundOrdered(bool boundOrdered)
+  {
+    _boundOrdered = boundOrdered;
+  }
+  
+  /// Stop once token is cancelled: no further combinations are started and
+  /// the running enumerations return the trees found so far. A stopped
+  /// combination is not marked as completed in the checkpoint
+  void setCancellationToken(const CancellationToken* token)
+  {
+    _cancellationToken = token;
+  }
+  
+  /// Write a checkpoint to filename every interval seconds and once
+  /// enumerate() is done
+  void setCheckpoint(const std::string& filename, int interval)
+  {
+    _checkpointFile = filename;
+    _checkpointInterval = interval;
+  }
+  
+  /// Continue from a checkpoint in the next call to enumerate(),
+  /// which must use the same input, clique file and parameters
+  void readCheckpoint(std::istream& in);
+  
+  void writeCheckpoint(std::ostream& out) const;
+  
+  /// Lower bound on the tree size used to prune the enumerations
+  int treeSizeBound() const
+  {
+    return _treeSizeBound.load();
+  }
+  
+  /// Raises the lower bound on the tree size, e.g. to the size of a tree
+  /// found by another process. Also affects enumerations in progress
+  void raiseTreeSizeBound(int bound)
+  {
+    int current = _treeSizeBound;
+    while (current < bound && !_treeSizeBound.compare_exchange_weak(current, bound));
+  }
+  
   void init(int state_tree_limit);
   
   int combinations() const
@@ -74,6 +135,35 @@ private:
              int state_tree_limit,
              bool monoclonal,
              const IntSet& whiteList);
+  
+  /// Solves the combinations handed out by nextCombination
+  void solveWorker(const StlIntMatrix& combinations,
+                   boost::atomic<int>& nextCombination,
+                   int limit,
+                   int timeLimit,
+                   int threads,
+                   int state_tree_limit,
+                   bool monoclonal,
+                   const IntSet& whiteList);
+  
+  void reportCombination(int count, int state_tree_limit);
+  
+  bool isCompleted(int combination) const;
+  
+  /// Removes the solutions whose tree was also found in a combination with
+  /// a lower index, which does not depend on the order of the combinations
+  void removeDuplicates();
+  
+  bool cancelled() const
+  {
+    return _cancellationToken && _cancellationToken->isCancelled();
+  }
+  
+  /// Writes a checkpoint every _checkpointInterval seconds until interrupted
+  void checkpointWorker();
+  
+  /// Replaces _checkpointFile by a new checkpoint
+  void saveCheckpoint() const;
     
   void collapse(const StlIntVector& mapNewCharToOldChar,
                 const StlIntVector& mapOldCharToNewChar,
@@ -91,7 +181,38 @@ private:
   const CompatibilityGraph& _comp;
   
   SolutionSet _sols;
+  /// If set, solutions are written to this stream instead of _sols
+  SolutionStream* _solutionStream;
+  /// Use bound-ordered exploration
+  bool _boundOrdered;
+  /// If set, the enumeration stops once this token is cancelled
+  const CancellationToken* _cancellationToken;
+  /// Trees of the largest size found in all state tree combinations
+  TreeHashSet _trees;
+  /// Size of the trees in _sols
   int _treeSize;
+  /// Lower bound on the tree size shared by all enumerations
+  boost::atomic<int> _treeSizeBound;
+  /// Guards _sols, _treeSize and output when solving combinations in parallel
+  mutable boost::mutex _mutex;
+  
+  /// Checkpoint file, empty if checkpointing is disabled
+  std::string _checkpointFile;
+  /// Seconds between checkpoints
+  int _checkpointInterval;
+  /// Combinations that have been solved
+  IntSet _completedCombinations;
+  /// Canonical forms of the trees in _sols
+  std::vector<TreeHashSet::CanonicalTree> _solTrees;
+  /// Combination in which each tree in _sols was found
+  StlIntVector _solCombinations;
+  /// Enumerations in progress by combination
+  std::map<int, const RootedCladisticEnumeration*> _runningEnumerations;
+  /// Progress of the combinations that were running when the checkpoint was
+  /// written, by combination
+  std::map<int, RootedCladisticEnumeration::Progress> _progress;
+  /// Whether readCheckpoint() has been called
+  bool _resumed;
   
   unsigned long _combinations;
   int _real_n;
@@ -0,0 +1,394 @@
+/*
+ * pairwisecompatibility.cpp
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#include "pairwisecompatibility.h"
+
+namespace gm {
+
+PairwiseCompatibility::PairwiseCompatibility(const StateTree& S_0,
+                                             const StateTree& S_1,
+                                             const RealTensor& F_lb,
+                                             const RealTensor& F_ub)
+  : _S()
+  , _F_lb(F_lb)
+  , _F_ub(F_ub)
+  , _nodes()
+  , _charStateToNode(2, StlIntVector(F_lb.k(), -1))
+  , _D(2, StlIntMatrix(F_lb.k()))
+  , _properD(2, StlIntMatrix(F_lb.k()))
+  , _cumLb()
+  , _cumUb()
+  , _arcSource()
+  , _arcTarget()
+  , _outArcs()
+  , _disabled()
+  , _parent()
+  , _size(0)
+  , _Fhat(2, StlDoubleVector(F_lb.k(), 0))
+  , _reached()
+  , _queue()
+{
+  _S[0] = &S_0;
+  _S[1] = &S_1;
+  
+  const int k = _F_lb.k();
+  const int m = _F_lb.m();
+  
+  // nodes in the order of RootedCladisticNoisyAncestryGraph
+  NodeInfo root = {-1, 0, -1};
+  _nodes.push_back(root);
+  
+  for (int c = 0; c < 2; ++c)
+  {
+    _charStateToNode[c][0] = 0;
+    for (int i = 1; i < k; ++i)
+    {
+      if (!_S[c]->isPresent(i))
+        continue;
+  
+      NodeInfo v_ci = {c, i, _S[c]->parent(i)};
+      _charStateToNode[c][i] = _nodes.size();
+      _nodes.push_back(v_ci);
+    }
+  
+    for (int i = 0; i < k; ++i)
+    {
+      if (!_S[c]->isPresent(i))
+        continue;
+  
+      const IntSet& D_ci = _S[c]->D(i);
+      for (int j : D_ci)
+      {
+        _D[c][i].push_back(j);
+        if (j != i)
+          _properD[c][i].push_back(j);
+      }
+    }
+  }
+  
+  const int nrNodes = _nodes.size();
+  _outArcs = StlIntMatrix(nrNodes);
+  
+  _cumLb = StlDoubleMatrix(nrNodes, StlDoubleVector(m, 1));
+  _cumUb = StlDoubleMatrix(nrNodes, StlDoubleVector(m, 1));
+  for (int v = 1; v < nrNodes; ++v)
+  {
+    for (int p = 0; p < m; ++p)
+    {
+      _cumLb[v][p] = cumFreq(_F_lb, p, v);
+      _cumUb[v][p] = cumFreq(_F_ub, p, v);
+    }
+  }
+  
+  // arcs of the two-character ancestry graph: state tree arcs
+  // (including those leaving the root)...
+  for (int c = 0; c < 2; ++c)
+  {
+    for (int i = 0; i < k; ++i)
+    {
+      if (_charStateToNode[c][i] == -1) continue;
+      for (int j = 1; j < k; ++j)
+      {
+        if (i == j || _charStateToNode[c][j] == -1) continue;
+        if (_S[c]->isParent(i, j))
+        {
+          addArc(_charStateToNode[c][i], _charStateToNode[c][j]);
+        }
+      }
+    }
+  }
+  
+  // ...and arcs between distinct characters that respect the intervals
+  for (int v = 1; v < nrNodes; ++v)
+  {
+    for (int w = 1; w < nrNodes; ++w)
+    {
+      if (_nodes[v]._c == _nodes[w]._c) continue;
+  
+      bool ok = true;
+      for (int p = 0; p < m && ok; ++p)
+      {
+        ok = !g_tol.less(_cumUb[v][p], _cumLb[w][p]);
+      }
+  
+      if (ok)
+      {
+        addArc(v, w);
+      }
+    }
+  }
+  
+  // lemon::ListDigraph iterates the out-arcs of a node in reverse order
+  // of insertion
+  for (int v = 0; v < nrNodes; ++v)
+  {
+    std::reverse(_outArcs[v].begin(), _outArcs[v].end());
+  }
+}
+
+void PairwiseCompatibility::addArc(int v, int w)
+{
+  _outArcs[v].push_back(_arcSource.size());
+  _arcSource.push_back(v);
+  _arcTarget.push_back(w);
+  _disabled.push_back(false);
+}
+
+double PairwiseCompatibility::cumFreq(const RealTensor& F,
+                                      int p,
+                                      int v) const
+{
+  const NodeInfo& v_ci = _nodes[v];
+  return F.getCumFreq(p, v_ci._c, _S[v_ci._c]->D(v_ci._i));
+}
+
+bool PairwiseCompatibility::run()
+{
+  const int nrNodes = _nodes.size();
+  const int m = _F_lb.m();
+  
+  _parent = StlIntVector(nrNodes, -1);
+  _size = 1;
+  _reached = StlBoolVector(nrNodes, false);
+  _queue.reserve(nrNodes);
+  
+  // the initial frontier of RootedCladisticEnumeration::init
+  StlIntVector F = _outArcs[0];
+  StlDoubleVector maxCumLb(nrNodes, 0);
+  for (int v = 1; v < nrNodes; ++v)
+  {
+    for (int p = 0; p < m; ++p)
+    {
+      maxCumLb[v] = std::max(maxCumLb[v], _cumLb[v][p]);
+    }
+  }
+  std::stable_sort(F.begin(), F.end(), [&](int a1, int a2)
+  {
+    return maxCumLb[_arcTarget[a1]] > maxCumLb[_arcTarget[a2]];
+  });
+  
+  return grow(F);
+}
+
+bool PairwiseCompatibility::prune(const StlIntVector& F)
+{
+  // nodes not in the tree can only be reached by frontier arcs and by
+  // arcs that leave nodes not in the tree and have not been excluded
+  const int nrNodes = _nodes.size();
+  std::fill(_reached.begin(), _reached.end(), false);
+  _queue.clear();
+  for (int a : F)
+  {
+    const int w = _arcTarget[a];
+    if (!_reached[w])
+    {
+      _reached[w] = true;
+      _queue.push_back(w);
+    }
+  }
+  
+  for (size_t idx = 0; idx < _queue.size(); ++idx)
+  {
+    for (int a : _outArcs[_queue[idx]])
+    {
+      const int w = _arcTarget[a];
+      if (!_disabled[a] && _parent[w] == -1 && !_reached[w])
+      {
+        _reached[w] = true;
+        _queue.push_back(w);
+      }
+    }
+  }
+  
+  return _size + static_cast<int>(_queue.size()) < nrNodes;
+}
+
+bool PairwiseCompatibility::isConsistent(int v, int w) const
+{
+  // the first ancestor of w of the same character must be its parent state
+  const NodeInfo& v_dj = _nodes[w];
+  while (v != 0)
+  {
+    if (_nodes[v]._c == v_dj._c)
+    {
+      return _nodes[v]._i == v_dj._pi;
+    }
+    v = _parent[v];
+  }
+  
+  return v_dj._pi == 0;
+}
+
+bool PairwiseCompatibility::checkFhat(int a)
+{
+  const int w = _arcTarget[a];
+  _parent[w] = _arcSource[a];
+  bool res = isFeasible();
+  _parent[w] = -1;
+  
+  return res;
+}
+
+bool PairwiseCompatibility::isFeasible(int v, int p, double& cumFhat)
+{
+  // children are summed in the order of the ancestry graph
+  double sum_of_children = 0;
+  for (int a : _outArcs[v])
+  {
+    const int w = _arcTarget[a];
+    if (_parent[w] != v)
+      continue;
+  
+    double cumFhat_w = 0;
+    if (!isFeasible(w, p, cumFhat_w))
+    {
+      return false;
+    }
+    sum_of_children += cumFhat_w;
+  }
+  
+  if (v == 0)
+  {
+    if (g_tol.less(1, sum_of_children))
+    {
+      return false;
+    }
+  
+    for (int c = 0; c < 2; ++c)
+    {
+      double sum_of_descendant_states = 0;
+      for (int j : _properD[c][0])
+      {
+        sum_of_descendant_states += _Fhat[c][j];
+      }
+  
+      double f_hat_p_c0 = 1 - sum_of_descendant_states;
+      if (g_tol.less(f_hat_p_c0, 0) || g_tol.less(1, f_hat_p_c0))
+      {
+        return false;
+      }
+    }
+  
+    cumFhat = 1;
+    return true;
+  }
+  else
+  {
+    const NodeInfo& v_ci = _nodes[v];
+    const int c = v_ci._c;
+    const int i = v_ci._i;
+  
+    // states that are not (yet) in the tree are at their lower bound
+    double sum_of_descendant_states = 0;
+    for (int j : _properD[c][i])
+    {
+      sum_of_descendant_states += _Fhat[c][j];
+    }
+  
+    double l_p_ci = _F_lb(i, p, c);
+    double u_p_ci = _F_ub(i, p, c);
+    double f_hat_p_ci = std::max(l_p_ci, sum_of_children - sum_of_descendant_states);
+    _Fhat[c][i] = f_hat_p_ci;
+  
+    cumFhat = 0;
+    for (int j : _D[c][i])
+    {
+      cumFhat += _Fhat[c][j];
+    }
+  
+    return !g_tol.less(f_hat_p_ci, l_p_ci) && !g_tol.less(u_p_ci, f_hat_p_ci);
+  }
+}
+
+bool PairwiseCompatibility::isFeasible()
+{
+  const int m = _F_lb.m();
+  const int k = _F_lb.k();
+  
+  for (int p = 0; p < m; ++p)
+  {
+    for (int c = 0; c < 2; ++c)
+    {
+      for (int i = 0; i < k; ++i)
+      {
+        _Fhat[c][i] = _F_lb(i, p, c);
+      }
+    }
+  
+    double cumFhat = 0;
+    if (!isFeasible(0, p, cumFhat))
+    {
+      return false;
+    }
+  }
+  
+  return true;
+}
+
+bool PairwiseCompatibility::grow(StlIntVector& F)
+{
+  if (_size == static_cast<int>(_nodes.size()))
+  {
+    // both characters are complete
+    return true;
+  }
+  else if (F.empty() || prune(F))
+  {
+    return false;
+  }
+  
+  // like RootedCladisticNoisyEnumeration::grow, branch on the last arc of
+  // the frontier and exclude it from the remaining branches
+  StlIntVector FF;
+  do
+  {
+    int a_cidj = F.back();
+    F.pop_back();
+  
+    const int v_ci = _arcSource[a_cidj];
+    const int v_dj = _arcTarget[a_cidj];
+  
+    _parent[v_dj] = v_ci;
+    ++_size;
+  
+    StlIntVector newF;
+    for (int a : F)
+    {
+      if (_arcTarget[a] != v_dj && checkFhat(a))
+      {
+        newF.push_back(a);
+      }
+    }
+    for (int a : _outArcs[v_dj])
+    {
+      const int v_el = _arcTarget[a];
+      if (!_disabled[a] && _parent[v_el] == -1
+          && isConsistent(v_dj, v_el) && checkFhat(a))
+      {
+        newF.push_back(a);
+      }
+    }
+  
+    if (grow(newF))
+      return true;
+  
+    _parent[v_dj] = -1;
+    --_size;
+  
+    _disabled[a_cidj] = true;
+    FF.push_back(a_cidj);
+  } while (!F.empty());
+  
+  for (StlIntVector::const_reverse_iterator it = FF.rbegin(); it != FF.rend(); ++it)
+  {
+    F.push_back(*it);
+    _disabled[*it] = false;
+  }
+  
+  return false;
+}
+
+} // namespace gm
@@ -0,0 +1,110 @@
+/*
+ * pairwisecompatibility.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef PAIRWISECOMPATIBILITY_H
+#define PAIRWISECOMPATIBILITY_H
+
+#include "utils.h"
+#include "realtensor.h"
+#include "statetree.h"
+
+namespace gm {
+
+/// Decides whether two characters with given state trees and frequency
+/// intervals can be part of the same noisy perfect phylogeny tree, that is,
+/// whether RootedCladisticNoisyEnumeration on the two-character ancestry
+/// graph attains objective value 2.
+///
+/// The enumeration rejects every candidate arc whose addition violates
+/// the intervals in the partial tree, where states that are not yet placed
+/// are at their lower bound. As \hat{f} of a partial tree may exceed that
+/// of its completions, which trees are found depends on the order in which
+/// arcs are added. The kernel therefore branches exactly like the
+/// enumeration: the same arc order, the same initial frontier and the same
+/// \hat{f} check on every frontier arc after each step. Rather than
+/// building an ancestry graph and enumerating all trees, it does so on flat
+/// arrays, computes \hat{f} directly from the intervals and the descendant
+/// sets D(i), prunes when the remaining nodes cannot all be reached, and
+/// stops at the first spanning tree.
+class PairwiseCompatibility
+{
+public:
+  /// F_lb and F_ub are k x m x 2 tensors, column c corresponds to S[c]
+  PairwiseCompatibility(const StateTree& S_0,
+                        const StateTree& S_1,
+                        const RealTensor& F_lb,
+                        const RealTensor& F_ub);
+  
+  bool run();
+  
+private:
+  /// Node 0 is the root, the remaining nodes are the present non-root states
+  struct NodeInfo
+  {
+    int _c;
+    int _i;
+    /// Parent state of _i in state tree _c
+    int _pi;
+  };
+  
+  typedef std::vector<NodeInfo> NodeInfoVector;
+  
+  bool grow(StlIntVector& F);
+  
+  bool prune(const StlIntVector& F);
+  
+  bool isConsistent(int v, int w) const;
+  
+  /// Returns whether adding arc a to the current tree respects the intervals
+  bool checkFhat(int a);
+  
+  /// Returns whether \hat{f} of the current tree respects the intervals
+  bool isFeasible();
+  
+  bool isFeasible(int v, int p, double& cumFhat);
+  
+  double cumFreq(const RealTensor& F, int p, int v) const;
+  
+  void addArc(int v, int w);
+  
+private:
+  const StateTree* _S[2];
+  const RealTensor& _F_lb;
+  const RealTensor& _F_ub;
+  
+  NodeInfoVector _nodes;
+  /// Node of character c in state i, -1 if state i is absent
+  StlIntMatrix _charStateToNode;
+  /// Descendant states of each state, including the state itself
+  std::vector<StlIntMatrix> _D;
+  /// Proper descendant states of each state
+  std::vector<StlIntMatrix> _properD;
+  /// Cumulative frequency lower bound of each node in each sample
+  StlDoubleMatrix _cumLb;
+  /// Cumulative frequency upper bound of each node in each sample
+  StlDoubleMatrix _cumUb;
+  
+  StlIntVector _arcSource;
+  StlIntVector _arcTarget;
+  /// Out-arcs of each node in the order of the ancestry graph
+  StlIntMatrix _outArcs;
+  /// Arcs excluded by the branches that are being explored
+  StlBoolVector _disabled;
+  
+  /// Parent of each node in the current tree, -1 if not in the tree
+  StlIntVector _parent;
+  int _size;
+  
+  /// \hat{f} of each character and state
+  StlDoubleMatrix _Fhat;
+  /// Nodes reached by prune
+  StlBoolVector _reached;
+  StlIntVector _queue;
+};
+
+} // namespace gm
+
+#endif // PAIRWISECOMPATIBILITY_H
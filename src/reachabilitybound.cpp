@@ -0,0 +1,481 @@
+/*
+ * reachabilitybound.cpp
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#include "reachabilitybound.h"
+
+namespace gm {
+
+ReachabilityBound::ReachabilityBound(const RootedCladisticAncestryGraph& G,
+                                     const CompactDigraph& compactG,
+                                     const IntSet& whiteList)
+  : _G(G)
+  , _compactG(compactG)
+  , _T(NULL)
+  , _root(compactG.id(G.root()))
+  , _nodeToChars(compactG.nodeNum())
+  , _nodeToStateChars(compactG.nodeNum())
+  , _charToNodes(G.F().n())
+  , _emptyNodes()
+  , _nrStates(G.F().n(), 0)
+  , _isWhiteListed(G.F().n(), false)
+  , _reached(compactG.nodeNum())
+  , _pred(compactG.nodeNum(), -1)
+  , _inF(compactG.arcNum())
+  , _fTargetCount(compactG.nodeNum(), 0)
+  , _missing(G.F().n(), 0)
+  , _inTCount(G.F().n(), 0)
+  , _nrComplete(0)
+  , _nrViolated(0)
+  , _changes()
+  , _marks()
+  , _frontiers(1)
+  , _depth(0)
+  , _orphan(compactG.nodeNum())
+  , _inNewF(compactG.arcNum())
+  , _orphans()
+  , _queue()
+  , _seeds()
+  , _candidates()
+{
+  for (int v : _compactG.nodes())
+  {
+    for (const IntPair& ci : _G.nodeToCharState(_compactG.nodeFromId(v)))
+    {
+      _nodeToChars[v].push_back(ci.first);
+      if (ci.second > 0)
+      {
+        _nodeToStateChars[v].push_back(ci.first);
+        _charToNodes[ci.first].push_back(v);
+        ++_nrStates[ci.first];
+      }
+    }
+    
+    if (v != _root && _nodeToChars[v].empty())
+    {
+      _emptyNodes.push_back(v);
+    }
+  }
+  
+  for (int c : whiteList)
+  {
+    _isWhiteListed[c] = true;
+  }
+}
+
+void ReachabilityBound::init(const CompactSubDigraph& T,
+                             const ArcList& F)
+{
+  const int n = _G.F().n();
+  
+  _T = &T;
+  _changes.clear();
+  _marks.clear();
+  _depth = 0;
+  
+  _inF.reset();
+  std::fill(_fTargetCount.begin(), _fTargetCount.end(), 0);
+  _frontiers[0].clear();
+  for (ArcListIt it = F.begin(); it != F.end(); ++it)
+  {
+    const int a = _compactG.id(*it);
+    _frontiers[0].push_back(a);
+    _inF.set(a);
+    ++_fTargetCount[_compactG.targetId(a)];
+  }
+  
+  std::fill(_inTCount.begin(), _inTCount.end(), 0);
+  for (int v : _compactG.nodes())
+  {
+    if (v != _root && T.nodes()[v])
+    {
+      for (int c : _nodeToChars[v])
+      {
+        ++_inTCount[c];
+      }
+    }
+  }
+  
+  // BFS in TT, the nodes of T are reached using the arcs of T first so
+  // that the forest path of each node of T is its path in T
+  _reached.reset();
+  std::fill(_pred.begin(), _pred.end(), -1);
+  _reached.set(_root);
+  _queue.assign(1, _root);
+  for (int phase = 0; phase < 2; ++phase)
+  {
+    for (size_t head = 0; head < _queue.size(); ++head)
+    {
+      const int v = _queue[head];
+      for (int idx = _compactG.outBegin(v); idx != _compactG.outEnd(v); ++idx)
+      {
+        const int a = _compactG.outArc(idx);
+        const int w = _compactG.targetId(a);
+        if (!_reached[w] && (phase == 0 ? T.arcs()[a] : isKept(a)))
+        {
+          _reached.set(w);
+          _pred[w] = a;
+          _queue.push_back(w);
+        }
+      }
+    }
+  }
+  
+  _missing = _nrStates;
+  for (int v : _queue)
+  {
+    for (int c : _nodeToStateChars[v])
+    {
+      --_missing[c];
+    }
+  }
+  
+  _nrComplete = _nrViolated = 0;
+  for (int c = 0; c < n; ++c)
+  {
+    if (_missing[c] == 0)
+      ++_nrComplete;
+    if (isViolated(c))
+      ++_nrViolated;
+  }
+}
+
+void ReachabilityBound::push(Arc a_cidj,
+                             const Arc* first,
+                             const Arc* last)
+{
+  mark();
+  
+  ++_depth;
+  if (static_cast<int>(_frontiers.size()) <= _depth)
+  {
+    _frontiers.resize(_depth + 1);
+  }
+  
+  const int a = _compactG.id(a_cidj);
+  const int v_dj = _compactG.targetId(a);
+  
+  // v_dj is now in T, its arcs are only retained if they are in T or F
+  for (int c : _nodeToChars[v_dj])
+  {
+    addInT(c, 1);
+  }
+  setPred(v_dj, a);
+  
+  StlIntVector& candidates = _candidates;
+  candidates.clear();
+  for (int idx = _compactG.outBegin(v_dj); idx != _compactG.outEnd(v_dj); ++idx)
+  {
+    candidates.push_back(_compactG.outArc(idx));
+  }
+  
+  // arcs that left F are only retained if they are in T
+  StlIntVector& newFrontier = _frontiers[_depth];
+  newFrontier.clear();
+  for (; first != last; ++first)
+  {
+    const int b = _compactG.id(*first);
+    newFrontier.push_back(b);
+    _inNewF.set(b);
+  }
+  for (int b : _frontiers[_depth - 1])
+  {
+    if (!_inNewF[b])
+    {
+      setInF(b, false);
+      candidates.push_back(b);
+    }
+  }
+  
+  // arcs targeting a node that became the target of an arc in F are removed
+  for (int b : newFrontier)
+  {
+    _inNewF.reset(b);
+    if (!_inF[b] && setInF(b, true))
+    {
+      const int w = _compactG.targetId(b);
+      for (int idx = _compactG.inBegin(w); idx != _compactG.inEnd(w); ++idx)
+      {
+        candidates.push_back(_compactG.inArc(idx));
+      }
+    }
+  }
+  
+  _seeds.clear();
+  for (int b : candidates)
+  {
+    const int w = _compactG.targetId(b);
+    if (_reached[w] && _pred[w] == b && !isKept(b))
+    {
+      _seeds.push_back(w);
+    }
+  }
+  
+  repair(_seeds);
+}
+
+void ReachabilityBound::pop()
+{
+  assert(_depth > 0);
+  --_depth;
+  rollBack();
+}
+
+bool ReachabilityBound::prune(int lowerbound)
+{
+  if (_nrViolated > 0 || _nrComplete < lowerbound)
+  {
+    return true;
+  }
+  
+  mark();
+  bool res = makeStateComplete(lowerbound) < lowerbound;
+  rollBack();
+  
+  return res;
+}
+
+int ReachabilityBound::upperBound()
+{
+  if (_nrViolated > 0)
+  {
+    return -1;
+  }
+  
+  mark();
+  int res = makeStateComplete(0);
+  rollBack();
+  
+  return res;
+}
+
+int ReachabilityBound::makeStateComplete(int lowerbound)
+{
+  const int n = _G.F().n();
+  
+  bool nodeRemoved = true;
+  while (nodeRemoved && _nrComplete >= lowerbound)
+  {
+    nodeRemoved = false;
+    
+    // removal only decreases the number of reached states, so the order
+    // in which unsupported nodes are removed does not matter
+    for (int c = 0; c < n; ++c)
+    {
+      if (_missing[c] == 0)
+        continue;
+      
+      for (int v : _charToNodes[c])
+      {
+        if (_reached[v] && isUnsupported(v))
+        {
+          removeNode(v);
+          nodeRemoved = true;
+        }
+      }
+    }
+    
+    for (int v : _emptyNodes)
+    {
+      if (_reached[v])
+      {
+        removeNode(v);
+        nodeRemoved = true;
+      }
+    }
+  }
+  
+  return _nrComplete;
+}
+
+void ReachabilityBound::removeNode(int v)
+{
+  setReached(v, false);
+  
+  _seeds.clear();
+  for (int idx = _compactG.outBegin(v); idx != _compactG.outEnd(v); ++idx)
+  {
+    const int a = _compactG.outArc(idx);
+    const int w = _compactG.targetId(a);
+    if (_reached[w] && _pred[w] == a)
+    {
+      _seeds.push_back(w);
+    }
+  }
+  
+  repair(_seeds);
+}
+
+void ReachabilityBound::repair(StlIntVector& seeds)
+{
+  // collect the forest subtrees rooted at the seeds
+  _orphans.clear();
+  while (!seeds.empty())
+  {
+    const int v = seeds.back();
+    seeds.pop_back();
+    if (!_reached[v] || _orphan[v])
+      continue;
+    
+    _orphan.set(v);
+    _orphans.push_back(v);
+    for (int idx = _compactG.outBegin(v); idx != _compactG.outEnd(v); ++idx)
+    {
+      const int a = _compactG.outArc(idx);
+      const int w = _compactG.targetId(a);
+      if (_reached[w] && !_orphan[w] && _pred[w] == a)
+      {
+        seeds.push_back(w);
+      }
+    }
+  }
+  
+  // reattach orphans with an arc from a node that is still reached...
+  _queue.clear();
+  for (int v : _orphans)
+  {
+    for (int idx = _compactG.inBegin(v); idx != _compactG.inEnd(v); ++idx)
+    {
+      const int a = _compactG.inArc(idx);
+      const int u = _compactG.sourceId(a);
+      if (_reached[u] && !_orphan[u] && isKept(a))
+      {
+        setPred(v, a);
+        _orphan.reset(v);
+        _queue.push_back(v);
+        break;
+      }
+    }
+  }
+  
+  // ...and the orphans reachable from these
+  for (size_t head = 0; head < _queue.size(); ++head)
+  {
+    const int v = _queue[head];
+    for (int idx = _compactG.outBegin(v); idx != _compactG.outEnd(v); ++idx)
+    {
+      const int a = _compactG.outArc(idx);
+      const int w = _compactG.targetId(a);
+      if (_orphan[w] && isKept(a))
+      {
+        setPred(w, a);
+        _orphan.reset(w);
+        _queue.push_back(w);
+      }
+    }
+  }
+  
+  for (int v : _orphans)
+  {
+    if (_orphan[v])
+    {
+      _orphan.reset(v);
+      setReached(v, false);
+    }
+  }
+}
+
+void ReachabilityBound::setPred(int v, int a)
+{
+  Change change = {CHANGE_PRED, v, _pred[v]};
+  _changes.push_back(change);
+  _pred[v] = a;
+}
+
+bool ReachabilityBound::setInF(int a, bool inF)
+{
+  const int w = _compactG.targetId(a);
+  
+  Change changeInF = {CHANGE_IN_F, a, _inF[a]};
+  Change changeCount = {CHANGE_F_TARGET_COUNT, w, _fTargetCount[w]};
+  _changes.push_back(changeInF);
+  _changes.push_back(changeCount);
+  
+  _inF[a] = inF;
+  _fTargetCount[w] += inF ? 1 : -1;
+  
+  return inF && _fTargetCount[w] == 1;
+}
+
+void ReachabilityBound::setReached(int v, bool reached)
+{
+  Change change = {CHANGE_REACHED, v, _reached[v]};
+  _changes.push_back(change);
+  _reached[v] = reached;
+  
+  for (int c : _nodeToStateChars[v])
+  {
+    addMissing(c, reached ? -1 : 1);
+  }
+}
+
+void ReachabilityBound::addMissing(int c, int delta)
+{
+  const bool complete = _missing[c] == 0;
+  const bool violated = isViolated(c);
+  
+  Change change = {CHANGE_MISSING, c, _missing[c]};
+  _changes.push_back(change);
+  _missing[c] += delta;
+  
+  _nrComplete += (_missing[c] == 0) - complete;
+  _nrViolated += isViolated(c) - violated;
+}
+
+void ReachabilityBound::addInT(int c, int delta)
+{
+  const bool violated = isViolated(c);
+  
+  Change change = {CHANGE_IN_T_COUNT, c, _inTCount[c]};
+  _changes.push_back(change);
+  _inTCount[c] += delta;
+  
+  _nrViolated += isViolated(c) - violated;
+}
+
+void ReachabilityBound::mark()
+{
+  Mark mark = {_changes.size(), _nrComplete, _nrViolated};
+  _marks.push_back(mark);
+}
+
+void ReachabilityBound::rollBack()
+{
+  assert(!_marks.empty());
+  const Mark& mark = _marks.back();
+  
+  while (_changes.size() > mark._nrChanges)
+  {
+    const Change& change = _changes.back();
+    switch (change._type)
+    {
+      case CHANGE_PRED:
+        _pred[change._idx] = change._value;
+        break;
+      case CHANGE_REACHED:
+        _reached[change._idx] = change._value;
+        break;
+      case CHANGE_IN_F:
+        _inF[change._idx] = change._value;
+        break;
+      case CHANGE_F_TARGET_COUNT:
+        _fTargetCount[change._idx] = change._value;
+        break;
+      case CHANGE_MISSING:
+        _missing[change._idx] = change._value;
+        break;
+      case CHANGE_IN_T_COUNT:
+        _inTCount[change._idx] = change._value;
+        break;
+    }
+    _changes.pop_back();
+  }
+  
+  _nrComplete = mark._nrComplete;
+  _nrViolated = mark._nrViolated;
+  _marks.pop_back();
+}
+
+} // namespace gm
@@ -0,0 +1,196 @@
+/*
+ * reachabilitybound.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef REACHABILITYBOUND_H
+#define REACHABILITYBOUND_H
+
+#include "utils.h"
+#include "compactdigraph.h"
+#include "frontierstack.h"
+#include "rootedcladisticancestrygraph.h"
+#include <list>
+
+namespace gm {
+
+/// Upper bound on the number of state-complete characters of any tree
+/// that extends a partial tree T with frontier F
+///
+/// The bound is the one of RootedCladisticEnumeration::prune. It is
+/// computed on the graph TT obtained from the ancestry graph by removing
+/// each arc not in T or F whose source is in T or whose target is the
+/// target of an arc in F. Rather than recomputing the nodes reachable from
+/// the root in TT at every search node, a spanning forest of these nodes is
+/// maintained as T grows. Only nodes whose forest path uses an arc that
+/// left TT are reattached. Changes are recorded in an undo log, so
+/// backtracking restores the bound of the parent search node.
+class ReachabilityBound
+{
+public:
+  DIGRAPH_TYPEDEFS(Digraph);
+  typedef std::list<Arc> ArcList;
+  typedef ArcList::const_iterator ArcListIt;
+  typedef CompactSubDigraph::BitSet BitSet;
+  
+  ReachabilityBound(const RootedCladisticAncestryGraph& G,
+                    const CompactDigraph& compactG,
+                    const IntSet& whiteList);
+  
+  /// Computes the bound from scratch for partial tree T and frontier F,
+  /// T is tracked by subsequent calls to push() and prune()
+  void init(const CompactSubDigraph& T, const ArcList& F);
+  
+  /// Updates the bound after arc a_cidj has been added to T and the
+  /// frontier has become F
+  void push(Arc a_cidj, const FrontierStack& F)
+  {
+    push(a_cidj, F.begin(), F.end());
+  }
+  
+  /// Updates the bound after arc a_cidj has been added to T and the
+  /// frontier has become [first, last)
+  void push(Arc a_cidj, const Arc* first, const Arc* last);
+  
+  /// Restores the bound prior to the last call to push()
+  void pop();
+  
+  /// Returns whether T cannot be extended to a tree with at least
+  /// lowerbound state-complete characters
+  bool prune(int lowerbound);
+  
+  /// Returns the number of state-complete characters of the largest tree
+  /// extending T, or -1 if T cannot be extended to a valid tree
+  int upperBound();
+
+private:
+  enum ChangeType
+  {
+    CHANGE_PRED,
+    CHANGE_REACHED,
+    CHANGE_IN_F,
+    CHANGE_F_TARGET_COUNT,
+    CHANGE_MISSING,
+    CHANGE_IN_T_COUNT
+  };
+  
+  struct Change
+  {
+    ChangeType _type;
+    int _idx;
+    int _value;
+  };
+  
+  struct Mark
+  {
+    size_t _nrChanges;
+    int _nrComplete;
+    int _nrViolated;
+  };
+  
+  typedef std::vector<Change> ChangeVector;
+  typedef std::vector<Mark> MarkVector;
+  
+  /// Returns whether arc a is in TT
+  bool isKept(int a) const
+  {
+    return _T->arcs()[a] || _inF[a]
+      || (!_T->nodes()[_compactG.sourceId(a)] && _fTargetCount[_compactG.targetId(a)] == 0);
+  }
+  
+  /// Returns whether character c must be state complete but is not
+  bool isViolated(int c) const
+  {
+    return (_isWhiteListed[c] || _inTCount[c] > 0) && _missing[c] > 0;
+  }
+  
+  /// Returns whether none of the characters of node v is state complete
+  bool isUnsupported(int v) const
+  {
+    for (int c : _nodeToChars[v])
+    {
+      if (_missing[c] == 0)
+        return false;
+    }
+    return true;
+  }
+  
+  void setPred(int v, int a);
+  
+  /// Returns whether a became the only arc of F targeting its target
+  bool setInF(int a, bool inF);
+  
+  void setReached(int v, bool reached);
+  
+  void addMissing(int c, int delta);
+  
+  void addInT(int c, int delta);
+  
+  void removeNode(int v);
+  
+  /// Detaches the forest subtrees rooted at seeds and reattaches their
+  /// nodes using arcs of TT, nodes that cannot be reattached are unreached.
+  /// Consumes seeds
+  void repair(StlIntVector& seeds);
+  
+  /// Removes the nodes without a state-complete character until none
+  /// remain, returns the number of state-complete characters
+  int makeStateComplete(int lowerbound);
+  
+  void mark();
+  
+  void rollBack();
+
+private:
+  const RootedCladisticAncestryGraph& _G;
+  const CompactDigraph& _compactG;
+  const CompactSubDigraph* _T;
+  int _root;
+  
+  /// Characters of each node
+  StlIntMatrix _nodeToChars;
+  /// Characters of the non-root states of each node
+  StlIntMatrix _nodeToStateChars;
+  /// Nodes of the non-root states of each character
+  StlIntMatrix _charToNodes;
+  /// Non-root nodes without any character
+  StlIntVector _emptyNodes;
+  /// Number of present non-root states of each character
+  StlIntVector _nrStates;
+  StlBoolVector _isWhiteListed;
+  
+  /// Nodes reachable from the root in TT
+  BitSet _reached;
+  /// Incoming forest arc of each reached node, -1 for the root
+  StlIntVector _pred;
+  /// Arcs of F
+  BitSet _inF;
+  /// Number of arcs of F targeting each node
+  StlIntVector _fTargetCount;
+  /// Number of non-root states of each character that are not reached
+  StlIntVector _missing;
+  /// Number of non-root nodes of T containing each character
+  StlIntVector _inTCount;
+  /// Number of characters c with _missing[c] == 0
+  int _nrComplete;
+  /// Number of characters c for which isViolated(c) holds
+  int _nrViolated;
+  
+  ChangeVector _changes;
+  MarkVector _marks;
+  /// Frontier of each search node on the current path
+  StlIntMatrix _frontiers;
+  int _depth;
+  
+  BitSet _orphan;
+  BitSet _inNewF;
+  StlIntVector _orphans;
+  StlIntVector _queue;
+  StlIntVector _seeds;
+  StlIntVector _candidates;
+};
+
+} // namespace gm
+
+#endif // REACHABILITYBOUND_H
@@ -10,7 +10,7 @@
 
 #include "tensor.h"
 #include "utils.h"
-#include <list>
+#include <vector>
 
 namespace gm {
   
@@ -110,7 +110,7 @@ protected:
     double _value;
   };
   
-  typedef std::list<Delta> DeltaList;
+  typedef std::vector<Delta> DeltaList;
   typedef DeltaList::const_iterator DeltaListIt;
   typedef DeltaList::const_reverse_iterator DeltaListRevIt;
   
@@ -6,7 +6,7 @@
  */
 
 #include "rootedcladisticenumeration.h"
-#include <lemon/bfs.h>
+#include <sstream>
 
 namespace gm {
 
@@ -19,21 +19,44 @@ RootedCladisticEnumeration::RootedCladisticEnumeration(const RootedCladisticAnce
                                                        bool fixTrunk,
                                                        const IntSet& whiteList)
   : _G(G)
+  , _compactG(G.G())
   , _result()
+  , _solutionCount(0)
+  , _solutionStream(NULL)
   , _objectiveValue(0)
   , _limit(limit)
   , _timeLimit(timeLimit)
   , _threads(threads)
   , _lowerbound(lowerbound)
+  , _sharedLowerbound(NULL)
   , _counter(0)
+  , _trees()
+  , _sharedTrees(NULL)
+  , _charIds(G.F().n())
+  , _owner(0)
   , _mutex()
-  , _sem(threads)
   , _threadGroup()
-  , _timer()
+  , _tasks()
+  , _activeWorkers(0)
+  , _idleWorkers(0)
+  , _pendingTasks(0)
+  , _taskMutex()
+  , _taskCondition()
+  , _unfinishedTasks()
+  , _abortedTasks()
+  , _completedTasks()
+  , _checkpointing(false)
+  , _cancellation()
+  , _deadline()
   , _monoclonal(monoclonal)
   , _fixTrunk(fixTrunk)
+  , _boundOrdered(false)
   , _whiteList(whiteList)
 {
+  for (int c = 0; c < G.F().n(); ++c)
+  {
+    _charIds[c] = c;
+  }
 }
   
 RootedCladisticEnumeration::~RootedCladisticEnumeration()
@@ -44,27 +67,8 @@ std::string RootedCladisticEnumeration::newick(int solIdx) const
 {
   assert(0 <= solIdx && solIdx < _result.size());
   
-  ArcListList::const_iterator it = _result.begin();
-  int tmp = solIdx;
-  for (; tmp > 0; tmp--) ++it;
-  
-  const ArcList& L = *it;
-  const Digraph& G = _G.G();
-  
-  BoolNodeMap filterNodesT(G, false);
-  BoolArcMap filterArcsT(G, false);
-  SubDigraph T(G, filterNodesT, filterArcsT);
-  
-  for (ArcListIt it = L.begin(); it != L.end(); ++it)
-  {
-    Arc a_cidj = *it;
-    Node v_ci = G.source(a_cidj);
-    Node v_dj = G.target(a_cidj);
-    
-    T.enable(a_cidj);
-    T.enable(v_ci);
-    T.enable(v_dj);
-  }
+  SubDigraph T(_compactG, false);
+  _result.init(solIdx, T);
   
   std::string str = "[";
   newick(T, _G.root(), str);
@@ -99,35 +103,30 @@ void RootedCladisticEnumeration::newick(const SubDigraph& T,
   }
 }
   
-bool RootedCladisticEnumeration::prune(const SubDigraph& T,
-                                       const ArcList& F) const
+bool RootedCladisticEnumeration::prune(ReachabilityBound& bound) const
 {
-  int size_L = 0;
-  {
-    boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
-    size_L = _lowerbound;
-  }
+  return bound.prune(getLowerbound());
+}
   
+#ifdef DEBUG
+int RootedCladisticEnumeration::upperBound(const SubDigraph& T,
+                                           const Arc* first,
+                                           const Arc* last) const
+{
   const Digraph& G = _G.G();
-  BoolNodeMap filterNodesTT(G, true);
-  BoolArcMap filterArcsTT(G, true);
+  SubDigraph TT(_compactG, true);
   
-  SubDigraph TT(G, filterNodesTT, filterArcsTT);
-  
-  // Remove arcs incoming to vertices in T and F
-  BoolArcMap whiteList(G, false);  // these are arcs that occur in F, and need to be retained in TT
-  BoolNodeMap blackList(G, false); // these are nodes that are the target nodes of an arc in F
-  for (ArcListIt it = F.begin(); it != F.end(); ++it)
+  // arcs in F are retained in TT, other arcs to their targets are not
+  BitSet inF(_compactG.arcNum());
+  BitSet isFTarget(_compactG.nodeNum());
+  for (; first != last; ++first)
   {
-    Arc a_cidj = *it;
-    whiteList[a_cidj] = true;
-    
-    Node v_dj = G.target(a_cidj);
-    blackList[v_dj] = true;
+    inF.set(_compactG.id(*first));
+    isFTarget.set(_compactG.id(G.target(*first)));
   }
   
   // determine set C of characters present in the tree (disregarding root)
-  IntSet C = _whiteList; // initialize to whitelist, these characters must be present in the tree
+  IntSet C = _whiteList;
   for (SubNodeIt v_ci(T); v_ci != lemon::INVALID; ++v_ci)
   {
     if (v_ci != _G.root())
@@ -138,61 +137,34 @@ bool RootedCladisticEnumeration::prune(const SubDigraph& T,
       }
     }
   }
-
-  //
+  
   for (ArcIt a_cidj(G); a_cidj != lemon::INVALID; ++a_cidj)
   {
     // retain arcs in T and F
-    if (T.status(a_cidj) || whiteList[a_cidj])
+    if (T.status(a_cidj) || inF[_compactG.id(a_cidj)])
       continue;
     
-    Node v_ci = G.source(a_cidj);
-    Node v_dj = G.target(a_cidj);
-    
-    // pre: a_cidj not in F
-    // pre: a_cidj not in T
-    if (T.status(v_ci))
+    if (T.status(G.source(a_cidj)) || isFTarget[_compactG.id(G.target(a_cidj))])
     {
-      // disable arcs incoming to vertices in T
-      TT.disable(a_cidj);
-    }
-    if (blackList[v_dj])
-    {
-      // disable arcs incoming to target vertices in F
       TT.disable(a_cidj);
     }
   }
   
-  // now do a BFS in TT
-  assert(TT.status(_G.root()));
-  lemon::Bfs<SubDigraph> bfs(TT);
-  bfs.run(_G.root());
+  BitSet reached;
+  TT.reached(_G.root(), reached);
+  TT.nodes() &= reached;
   
-  for (NodeIt v_ci(_G.G()); v_ci != lemon::INVALID; ++v_ci)
+  for (int c : C)
   {
-    if (!bfs.reached(v_ci))
-      TT.disable(v_ci);
-  }
-  
-  // check if there is a character that is state incomplete
-  for (IntSetIt it = C.begin(); it != C.end(); ++it)
-  {
-    int c = *it;
     if (!isStateComplete(TT, c))
     {
-      return true;
+      return -1;
     }
   }
   
-  int size_TT = makeStateComplete(TT);
-  if (size_TT < size_L)
-  {
-//    std::cout << "TT: " << size_TT << ", L: " << size_L << ", F: " << F.size() << std::endl;
-    return true;
-  }
-  
-  return false;
+  return makeStateComplete(TT);
 }
+#endif
   
 void RootedCladisticEnumeration::init(Arc a_00dj,
                                       SubDigraph& subG,
@@ -266,29 +238,104 @@ void RootedCladisticEnumeration::init(SubDigraph& subG,
   F.sort(Compare(_G));
 }
   
-void RootedCladisticEnumeration::runArc(Arc a_00dj)
+void RootedCladisticEnumeration::pushTask(const Task& task)
 {
-  _sem.wait();
-  const Digraph& G = _G.G();
+  boost::unique_lock<boost::mutex> lock(_taskMutex);
+  _tasks.push_back(task);
+  ++_pendingTasks;
+  if (task._rootTask != -1)
+  {
+    ++_unfinishedTasks[task._rootTask];
+  }
+  _taskCondition.notify_one();
+}
   
-  BoolNodeMap filterNodesT(G, false);
-  BoolArcMap filterArcsT(G, false);
-  SubDigraph T(G, filterNodesT, filterArcsT);
+void RootedCladisticEnumeration::finishTask(int rootTask, bool aborted)
+{
+  if (rootTask == -1)
+    return;
   
-  BoolNodeMap filterNodesG(G, true);
-  BoolArcMap filterArcsG(G, true);
-  SubDigraph subG(G, filterNodesG, filterArcsG);
+  if (aborted)
+  {
+    _abortedTasks.insert(rootTask);
+  }
   
-  ArcList F;
+  if (--_unfinishedTasks[rootTask] == 0)
+  {
+    _unfinishedTasks.erase(rootTask);
+    if (_abortedTasks.count(rootTask) == 0)
+    {
+      boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+      _completedTasks.insert(rootTask);
+    }
+  }
+}
   
-  init(a_00dj, subG, T, F);
-  grow(subG, T, F);
+bool RootedCladisticEnumeration::runTask(const Task& task)
+{
+  SubDigraph T(_compactG, false);
+  initSubDigraph(task._nodesT, task._arcsT, T);
   
-//  for (int idx = 0; idx < _result.size(); ++idx)
-//  {
-//    std::cerr << newick(idx) << " " << idx << std::endl;
-//  }
-  _sem.post();
+  SubDigraph subG(_compactG, true);
+  initSubDigraph(task._nodesG, task._arcsG, subG);
+  
+  ArcList F = task._F;
+  ReachabilityBound bound(_G, _compactG, _whiteList);
+  bound.init(T, F);
+  return grow(subG, T, F, bound, task._stop, task._rootTask);
+}
+  
+void RootedCladisticEnumeration::worker()
+{
+  Task task;
+  while (true)
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(_taskMutex);
+      ++_idleWorkers;
+      while (_tasks.empty() && _activeWorkers > 0)
+      {
+        _taskCondition.wait(lock);
+      }
+      --_idleWorkers;
+      
+      if (_tasks.empty())
+      {
+        // no pending tasks and no busy workers that could split off new ones
+        _taskCondition.notify_all();
+        return;
+      }
+      
+      task = _tasks.front();
+      _tasks.pop_front();
+      --_pendingTasks;
+      ++_activeWorkers;
+    }
+    
+    bool aborted = runTask(task);
+    
+    {
+      boost::unique_lock<boost::mutex> lock(_taskMutex);
+      --_activeWorkers;
+      finishTask(task._rootTask, aborted);
+      if (_activeWorkers == 0 && _tasks.empty())
+      {
+        _taskCondition.notify_all();
+      }
+    }
+  }
+}
+  
+void RootedCladisticEnumeration::runTasks()
+{
+  _activeWorkers = 0;
+  _idleWorkers = 0;
+  for (int i = 0; i < _threads; ++i)
+  {
+    _threadGroup.create_thread(boost::bind(&RootedCladisticEnumeration::worker, this));
+  }
+  
+  _threadGroup.join_all();
 }
   
 void RootedCladisticEnumeration::run()
@@ -296,33 +343,47 @@ void RootedCladisticEnumeration::run()
   const Digraph& G = _G.G();
   Node root = _G.root();
   
-  _timer.start();
+  startTimer();
   _counter = 0;
-  if (_threads == 1)
+  if (_threads == 1 && !_checkpointing)
   {
-    BoolNodeMap filterNodesT(G, false);
-    BoolArcMap filterArcsT(G, false);
-    SubDigraph T(G, filterNodesT, filterArcsT);
-    
-    BoolNodeMap filterNodesG(G, true);
-    BoolArcMap filterArcsG(G, true);
-    SubDigraph subG(G, filterNodesG, filterArcsG);
+    SubDigraph T(_compactG, false);
+    SubDigraph subG(_compactG, true);
     
     ArcList F;
     
     init(subG, T, F);
-    grow(subG, T, F);
+    ReachabilityBound bound(_G, _compactG, _whiteList);
+    bound.init(T, F);
+    grow(subG, T, F, bound, 0, -1);
   }
   else
   {
-    for (OutArcIt a_00dj(G, root); a_00dj != lemon::INVALID; ++a_00dj)
+    if (g_verbosity >= VERBOSE_ESSENTIAL && !_completedTasks.empty())
     {
-//      std::cerr << _G.label(G.target(a_00dj)) << std::endl;
-      _threadGroup.create_thread(boost::bind(&RootedCladisticEnumeration::runArc, this, a_00dj));
-//      RootedCladisticEnumeration::runArc(a_00dj);
+      std::cerr << "Skipping " << _completedTasks.size() << " completed root tasks" << std::endl;
+    }
+    
+    // one initial task per root arc, idle workers split these further
+    int rootTask = 0;
+    for (OutArcIt a_00dj(G, root); a_00dj != lemon::INVALID; ++a_00dj, ++rootTask)
+    {
+      if (_completedTasks.count(rootTask))
+        continue;
+      
+      SubDigraph T(_compactG, false);
+      SubDigraph subG(_compactG, true);
+      
+      ArcList F;
+      init(a_00dj, subG, T, F);
+      
+      Task task;
+      initTask(subG, T, F, 0, F.size(), task);
+      task._rootTask = rootTask;
+      pushTask(task);
     }
     
-    _threadGroup.join_all();
+    runTasks();
   }
 
   if (g_verbosity >= VERBOSE_ESSENTIAL)
@@ -337,27 +398,17 @@ bool RootedCladisticEnumeration::finalize(SubDigraph& T)
   
 //  writeDOT(std::cout, T, ArcList());
   
-  boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
-  ++_counter;
-  int currentSize = std::max(_lowerbound, _objectiveValue);
+  const int counter = ++_counter;
+  int currentSize = std::max(getLowerbound(), _objectiveValue.load());
   
   if (g_verbosity >= VERBOSE_NON_ESSENTIAL)
   {
-    std::cerr << "\r" << _result.size() << "/" << _counter << "/" << _limit << " (" << _lowerbound << ")" << std::flush;
+    boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+    std::cerr << "\r" << _solutionCount.load() << "/" << counter << "/" << _limit << " (" << _lowerbound.load() << ")" << std::flush;
   }
   
-  // make copy of T
-  BoolNodeMap filterNodesT(_G.G(), false);
-  BoolArcMap filterArcsT(_G.G(), false);
-  SubDigraph TT(_G.G(), filterNodesT, filterArcsT);
-  for (NodeIt v_ci(_G.G()); v_ci != lemon::INVALID; ++v_ci)
-  {
-    TT.status(v_ci, T.status(v_ci));
-  }
-  for (ArcIt a_cidj(_G.G()); a_cidj != lemon::INVALID; ++ a_cidj)
-  {
-    TT.status(a_cidj, T.status(a_cidj));
-  }
+  // make copy of T, this and the checks below do not need the lock
+  SubDigraph TT(T);
   
   int newSizeT = makeStateComplete(TT);
   
@@ -378,142 +429,231 @@ bool RootedCladisticEnumeration::finalize(SubDigraph& T)
   {
     return false;
   }
-  else if (newSizeT > currentSize && !_result.empty())
+  
+  // different spanning trees may have the same state-complete tree. A
+  // streamed tree cannot be taken back, so there the first one found is kept
+  if (!_solutionStream || _solutionStream->removeDuplicates())
+  {
+    TreeHashSet::CanonicalTree tree;
+    canonicalTree(TT, tree);
+    if (!(_sharedTrees ? _sharedTrees : &_trees)->insert(tree, newSizeT, _solutionStream ? 0 : _owner))
+    {
+      return false;
+    }
+  }
+  
+  Solution sol;
+  if (_solutionStream)
+  {
+    // the tree is written right away instead of being stored
+    SubDigraph TTT(_compactG, false);
+    TTT.enable(_G.root());
+    for (SubArcIt a_cidj(TT); a_cidj != lemon::INVALID; ++a_cidj)
+    {
+      TTT.enable(TT.source(a_cidj));
+      TTT.enable(TT.target(a_cidj));
+      TTT.enable(a_cidj);
+    }
+    sol = solution(TTT);
+  }
+  
+  boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+  
+  // other threads may have found larger trees in the meantime
+  currentSize = std::max(getLowerbound(), _objectiveValue.load());
+  if (newSizeT < currentSize)
+  {
+    return false;
+  }
+  
+  // the stream discards trees smaller than those written by the
+  // enumerations of other state tree combinations
+  if (_solutionStream && !_solutionStream->add(newSizeT, sol))
   {
-    _objectiveValue = _lowerbound = newSizeT;
+    return false;
+  }
+  
+  if (newSizeT > _objectiveValue && _solutionCount > 0)
+  {
+    // _result only holds trees of size _objectiveValue
+    _objectiveValue = newSizeT;
+    _lowerbound = newSizeT;
     if (g_verbosity >= VERBOSE_ESSENTIAL)
     {
-      std::cerr << "\r" << _result.size() << "/" << _counter << "/" << _limit << " (" << _lowerbound << ")" << std::endl;
+      std::cerr << "\r" << _solutionCount.load() << "/" << _counter.load() << "/" << _limit << " (" << _lowerbound.load() << ")" << std::endl;
     }
     _result.clear();
+    _solutionCount = 0;
   }
   else
   {
     _objectiveValue = newSizeT;
   }
+  raiseSharedLowerbound(newSizeT);
   
-  _result.push_back(ArcList());
-  ArcList& res = _result.back();
-  
-  for (SubArcIt a_cidj(TT); a_cidj != lemon::INVALID; ++a_cidj)
+  if (!_solutionStream)
   {
-    res.push_back(a_cidj);
+    _result.add(TT);
   }
+  ++_solutionCount;
   
-  return _result.size() >= _limit;
+  return _limit != -1 && _solutionCount >= _limit;
 }
   
 bool RootedCladisticEnumeration::grow(SubDigraph& G,
                                       SubDigraph& T,
-                                      ArcList& F)
+                                      const ArcList& F_init,
+                                      ReachabilityBound& bound,
+                                      size_t stop,
+                                      int rootTask)
 {
-  if (limitReached())
-  {
-    return true;
-  }
-  else if (F.empty())
-  {
-    return finalize(T);
-  }
-  else if (prune(T, F))
-  {
-    return false;
-  }
-  else
+  // depth-first search using an explicit stack, the frontier of each
+  // search node on the stack is on the frontier stack
+  FrontierStack F;
+  F.push(F_init.begin(), F_init.end());
+  SearchNodeVector path;
+  OrderBuffers buffers;
+  
+  while (true)
   {
-    ArcList FF;
+    bool expand = false;
+    if (limitReached())
+    {
+      return true;
+    }
+    else if (F.empty())
+    {
+      if (finalize(T))
+        return true;
+    }
+    else if (!prune(bound))
+    {
+      expand = true;
+    }
     
-    do
+    if (expand)
     {
-      assert(!F.empty());
-      
-      Arc a_cidj = F.back();
-      F.pop_back();
+      SearchNode node;
+      node._a_cidj = lemon::INVALID;
+      node._stop = path.empty() ? stop : 0;
+      path.push_back(node);
       
-//      Arc a_cidj = F.front();
-//      F.pop_front();
-      Node v_ci = G.source(a_cidj);
-      Node v_dj = G.target(a_cidj);
-      
-      assert(T.status(v_ci));
-      assert(!T.status(v_dj));
-      assert(!T.status(a_cidj));
-      
-      // add a_cidj to T
-      addArc(T, a_cidj);
-      
-      ArcList newF = F;
-      
-      // remove each arc wv where w in T from F
-      for (ArcListNonConstIt it = newF.begin(); it != newF.end();)
+      if (_boundOrdered)
       {
-        if (G.target(*it) == v_dj)
-        {
-          assert(T.status(G.source(*it)));
-          it = newF.erase(it);
-        }
-        else if (G.source(*it) == v_ci && !isValid(T, *it))
-        {
-          it = newF.erase(it);
-        }
-        else
-        {
-          assert(isValid(T, *it));
-          ++it;
-        }
+        orderFrontier(G, T, F, node._stop, bound, buffers);
       }
-      
-      // push each arc a_djel where v_el not in V(T) onto F
-      for (SubOutArcIt a_djel(G, v_dj); a_djel != lemon::INVALID; ++a_djel)
+    }
+    else
+    {
+      // backtrack to the deepest search node with arcs left to branch on
+      F.pop();
+      while (!path.empty())
       {
-        Node v_el = G.target(a_djel);
+        const SearchNode& node = path.back();
+        bound.pop();
+        G.disable(node._a_cidj);
+        removeArc(T, node._a_cidj);
+#ifdef DEBUG
+        assert(bound.upperBound() == upperBound(T, F.begin(), F.removedEnd()));
+#endif
         
-        // violation of tree constraint (no cycles)
-        if (T.status(v_el))
-          continue;
-        
-        // isFirstAncestor violation (consistency)
-        bool isConsistent = true;
-        for (const IntPair& el : _G.nodeToCharState(v_el))
-        {
-          int pi_l = _G.S(el.first).parent(el.second);
-          assert(pi_l != -1 && pi_l != -2);
-          if (!(pi_l != -1 && pi_l != -2))
-          {
-            abort();
-          }
-          Node v_e_pi_l = _G.charStateToNode(el.first, pi_l);
-          assert(v_e_pi_l != lemon::INVALID);
-          
-          isConsistent = isConsistent && isFirstAncestor(T, el.first, v_e_pi_l, v_dj);
-        }
+        if (F.size() > node._stop)
+          break;
         
-        if (isValid(T, a_djel))
+        for (const Arc* it = F.end(); it != F.removedEnd(); ++it)
         {
-          newF.push_back(a_djel);
+          Arc a = *it;
+          assert(!G.status(a));
+          G.enable(a);
         }
+        F.restore();
+        F.pop();
+        path.pop_back();
       }
       
-      if (grow(G, T, newF))
-        return true;
-      
-      G.disable(a_cidj);
-      
-      removeArc(T, a_cidj);
-      
-      FF.push_back(a_cidj);
-    } while (!F.empty());
+      if (path.empty())
+        return false;
+    }
+    
+    SearchNode& node = path.back();
+    assert(F.size() > node._stop);
+    
+    // hand the front half of our frontier to idle workers
+    if (_threads > 1 && F.size() - node._stop > 1 && hasIdleWorkers())
+    {
+      size_t count = (F.size() - node._stop) / 2;
+      Task task;
+      initTask(G, T, F, node._stop, count, task);
+      task._rootTask = rootTask;
+      pushTask(task);
+      node._stop += count;
+    }
+    
+    Arc a_cidj = F.back();
+    F.pop_back();
+    node._a_cidj = a_cidj;
+    
+    Node v_ci = G.source(a_cidj);
+    Node v_dj = G.target(a_cidj);
+    
+    assert(T.status(v_ci));
+    assert(!T.status(v_dj));
+    assert(!T.status(a_cidj));
+    
+    // add a_cidj to T
+    addArc(T, a_cidj);
     
-    for (ArcListRevIt it = FF.rbegin(); it != FF.rend(); ++it)
+    F.push();
+    
+    // remove each arc wv where w in T from F
+    size_t size = 0;
+    for (size_t idx = 0; idx < F.size(); ++idx)
+    {
+      Arc a = F[idx];
+      assert(G.target(a) != v_dj || T.status(G.source(a)));
+      if (G.target(a) != v_dj && (G.source(a) != v_ci || isValid(T, a)))
+      {
+        assert(isValid(T, a));
+        F[size++] = a;
+      }
+    }
+    F.resize(size);
+    
+    // push each arc a_djel where v_el not in V(T) onto F
+    for (SubOutArcIt a_djel(G, v_dj); a_djel != lemon::INVALID; ++a_djel)
     {
-      Arc a = *it;
-      assert(!G.status(a));
+      Node v_el = G.target(a_djel);
+      
+      // violation of tree constraint (no cycles)
+      if (T.status(v_el))
+        continue;
       
-      F.push_back(*it);
-      G.enable(a);
+      // isFirstAncestor violation (consistency)
+      bool isConsistent = true;
+      for (const IntPair& el : _G.nodeToCharState(v_el))
+      {
+        int pi_l = _G.S(el.first).parent(el.second);
+        assert(pi_l != -1 && pi_l != -2);
+        if (!(pi_l != -1 && pi_l != -2))
+        {
+          abort();
+        }
+        Node v_e_pi_l = _G.charStateToNode(el.first, pi_l);
+        assert(v_e_pi_l != lemon::INVALID);
+        
+        isConsistent = isConsistent && isFirstAncestor(T, el.first, v_e_pi_l, v_dj);
+      }
+      
+      if (isValid(T, a_djel))
+      {
+        F.push_back(a_djel);
+      }
     }
     
-    return false;
+    bound.push(a_cidj, F);
+#ifdef DEBUG
+    assert(bound.upperBound() == upperBound(T, F.begin(), F.end()));
+#endif
   }
 }
   
@@ -582,6 +722,57 @@ bool RootedCladisticEnumeration::isAncestor(const SubDigraph& T,
   return v_ci == v_dj;
 }
   
+void RootedCladisticEnumeration::orderFrontier(const SubDigraph& G,
+                                               SubDigraph& T,
+                                               FrontierStack& F,
+                                               size_t stop,
+                                               ReachabilityBound& bound,
+                                               OrderBuffers& buffers) const
+{
+  if (F.size() - stop < 2)
+    return;
+  
+  // (bound, position) pairs, ties keep the depth-first order
+  std::vector<IntPair>& scores = buffers._scores;
+  FrontierStack::ArcVector& arcs = buffers._arcs;
+  FrontierStack::ArcVector& FF = buffers._FF;
+  scores.clear();
+  arcs.assign(F.begin() + stop, F.end());
+  for (size_t idx = 0; idx < arcs.size(); ++idx)
+  {
+    const Arc a_cidj = arcs[idx];
+    const Node v_dj = G.target(a_cidj);
+    
+    // the frontier after adding a_cidj without the validity checks,
+    // this only enlarges the bound
+    FF.clear();
+    for (Arc a : F)
+    {
+      if (G.target(a) != v_dj)
+        FF.push_back(a);
+    }
+    for (SubOutArcIt a_djel(G, v_dj); a_djel != lemon::INVALID; ++a_djel)
+    {
+      if (!T.status(G.target(a_djel)))
+        FF.push_back(a_djel);
+    }
+    
+    T.enable(v_dj);
+    T.enable(a_cidj);
+    bound.push(a_cidj, FF.data(), FF.data() + FF.size());
+    scores.push_back(IntPair(bound.upperBound(), idx));
+    bound.pop();
+    T.disable(a_cidj);
+    T.disable(v_dj);
+  }
+  
+  std::sort(scores.begin(), scores.end());
+  for (size_t idx = 0; idx < scores.size(); ++idx)
+  {
+    F[stop + idx] = arcs[scores[idx].second];
+  }
+}
+  
 void RootedCladisticEnumeration::addArc(SubDigraph& T,
                                         Arc a_cidj) const
 {
@@ -613,18 +804,10 @@ void RootedCladisticEnumeration::removeArc(SubDigraph& T,
 bool RootedCladisticEnumeration::isArborescence(const SubDigraph& T) const
 {
   assert(T.status(_G.root()));
-  lemon::Bfs<SubDigraph> bfs(T);
-  bfs.run(_G.root());
-  
-  for (SubNodeIt v_ci(T); v_ci != lemon::INVALID; ++v_ci)
-  {
-    if (!bfs.reached(v_ci))
-    {
-      return false;
-    }
-  }
+  BitSet reached;
+  T.reached(_G.root(), reached);
   
-  return true;
+  return T.nodes().is_subset_of(reached);
 }
   
 bool RootedCladisticEnumeration::isValid(const SubDigraph& T) const
@@ -726,26 +909,17 @@ bool RootedCladisticEnumeration::isValid(const SubDigraph& T,
 Solution RootedCladisticEnumeration::solution(int solIdx) const
 {
   assert(0 <= solIdx && solIdx < _result.size());
-  const int n = _G.F().n();
-  const Digraph& G = _G.G();
   
-  ArcListList::const_iterator it = _result.begin();
-  int tmp = solIdx;
-  for (; tmp > 0; tmp--) ++it;
-  
-  BoolNodeMap nodes(G, false);
-  BoolArcMap arcs(G, false);
-  SubDigraph T(G, nodes, arcs);
+  SubDigraph T(_compactG, false);
   T.enable(_G.root());
+  _result.init(solIdx, T);
   
-  const ArcList& arcList = *it;
-  for (ArcListIt it2 = arcList.begin(); it2 != arcList.end(); ++it2)
-  {
-    Arc a = *it2;
-    T.enable(G.source(a));
-    T.enable(G.target(a));
-    T.enable(a);
-  }
+  return solution(T);
+}
+  
+Solution RootedCladisticEnumeration::solution(const SubDigraph& T) const
+{
+  const int n = _G.F().n();
   
   assert(T.status(_G.root()));
   
@@ -760,12 +934,59 @@ Solution RootedCladisticEnumeration::solution(int solIdx) const
 //  writeDOT(std::cerr, T, ArcList());
   
   initA(T, _G.root(), stateComplete, sol._A);
-  initF(solIdx, sol._inferredF);
+  initF(T, sol._inferredF);
   initU(T, sol._inferredF, _G.root(), stateComplete, sol._U);
   
   return sol;
 }
   
+void RootedCladisticEnumeration::canonicalTree(const SubDigraph& T,
+                                               TreeHashSet::CanonicalTree& tree) const
+{
+  const int n = _G.F().n();
+  
+  StlBoolVector stateComplete(n, false);
+  for (int c = 0; c < n; ++c)
+  {
+    stateComplete[c] = isStateComplete(T, c);
+  }
+  
+  // the states of a node form a chain, as in initA()
+  tree.clear();
+  for (SubNodeIt v_ci(T); v_ci != lemon::INVALID; ++v_ci)
+  {
+    if (v_ci == _G.root())
+      continue;
+    
+    Node v_pi_ci = T.source(SubInArcIt(T, v_ci));
+    IntPair pi_ci(-1, -1);
+    if (v_pi_ci != _G.root())
+    {
+      const auto& X_pi_ci = _G.nodeToCharStateList(v_pi_ci);
+      for (auto it = X_pi_ci.rbegin(); it != X_pi_ci.rend(); ++it)
+      {
+        if (stateComplete[it->first])
+        {
+          pi_ci = IntPair(_charIds[it->first], it->second);
+          break;
+        }
+      }
+    }
+    
+    for (const IntPair& ci : _G.nodeToCharStateList(v_ci))
+    {
+      if (!stateComplete[ci.first])
+        continue;
+      
+      IntPair cci(_charIds[ci.first], ci.second);
+      tree.push_back(TreeHashSet::CharStateArc(pi_ci, cci));
+      pi_ci = cci;
+    }
+  }
+  
+  std::sort(tree.begin(), tree.end());
+}
+  
 void RootedCladisticEnumeration::writeDOT(std::ostream& out,
                                           const SubDigraph& T,
                                           const ArcList& H) const
@@ -1013,12 +1234,128 @@ void RootedCladisticEnumeration::initU(const SubDigraph& T,
   }
 }
   
+void RootedCladisticEnumeration::getProgress(Progress& progress) const
+{
+  boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+  
+  progress._objectiveValue = _objectiveValue;
+  progress._completedTasks = _completedTasks;
+  progress._trees = _result;
+}
+  
+void RootedCladisticEnumeration::setProgress(const Progress& progress)
+{
+  const int nrArcs = _compactG.arcNum();
+  for (int idx = 0; idx < progress._trees.size(); ++idx)
+  {
+    for (const int* it = progress._trees.begin(idx); it != progress._trees.end(idx); ++it)
+    {
+      if (*it < 0 || *it >= nrArcs)
+      {
+        throw std::runtime_error("Error: invalid arc id");
+      }
+    }
+  }
+  
+  _objectiveValue = progress._objectiveValue;
+  _lowerbound = std::max(_lowerbound.load(), progress._objectiveValue);
+  _completedTasks = progress._completedTasks;
+  _result = progress._trees;
+  _solutionCount = _result.size();
+  
+  // trees found again by the tasks that were not completed are dropped
+  std::vector<TreeHashSet::CanonicalTree> trees;
+  canonicalTrees(trees);
+  for (const TreeHashSet::CanonicalTree& tree : trees)
+  {
+    (_sharedTrees ? _sharedTrees : &_trees)->insert(tree, progress._objectiveValue, _owner);
+  }
+}
+  
+void RootedCladisticEnumeration::canonicalTrees(std::vector<TreeHashSet::CanonicalTree>& trees) const
+{
+  boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+  
+  trees.resize(_result.size());
+  for (int idx = 0; idx < _result.size(); ++idx)
+  {
+    SubDigraph T(_compactG, false);
+    T.enable(_G.root());
+    _result.init(idx, T);
+    canonicalTree(T, trees[idx]);
+  }
+}
+  
+std::ostream& operator<<(std::ostream& out,
+                         const RootedCladisticEnumeration::Progress& progress)
+{
+  out << progress._objectiveValue << " #objective value" << std::endl;
+  out << progress._completedTasks.size() << " #completed tasks" << std::endl;
+  bool first = true;
+  for (int task : progress._completedTasks)
+  {
+    if (first)
+      first = false;
+    else
+      out << " ";
+    out << task;
+  }
+  out << std::endl;
+  out << progress._trees;
+  
+  return out;
+}
+  
+std::istream& operator>>(std::istream& in,
+                         RootedCladisticEnumeration::Progress& progress)
+{
+  std::string line;
+  gm::getline(in, line);
+  std::stringstream ss(line);
+  
+  progress._objectiveValue = -1;
+  ss >> progress._objectiveValue;
+  if (progress._objectiveValue < 0)
+  {
+    throw std::runtime_error(getLineNumber() + "Error: invalid objective value");
+  }
+  
+  int taskCount = -1;
+  gm::getline(in, line);
+  ss.clear();
+  ss.str(line);
+  ss >> taskCount;
+  if (taskCount < 0)
+  {
+    throw std::runtime_error(getLineNumber() + "Error: invalid number of completed tasks");
+  }
+  
+  gm::getline(in, line);
+  ss.clear();
+  ss.str(line);
+  progress._completedTasks.clear();
+  for (int idx = 0; idx < taskCount; ++idx)
+  {
+    int task = -1;
+    if (!(ss >> task) || task < 0)
+    {
+      throw std::runtime_error(getLineNumber() + "Error: '" + line
+                               + "' is not a list of task indices");
+    }
+    progress._completedTasks.insert(task);
+  }
+  
+  in >> progress._trees;
+  
+  return in;
+}
+  
 void RootedCladisticEnumeration::populateSolutionSet(SolutionSet& sols) const
 {
   boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
   
 //  SolutionSet localSols;
-  int solCount = solutionCount();
+  int solCount = _result.size();
   for (int idx = 0; idx < solCount; ++idx)
   {
 //    localSols.add(solution(idx));
@@ -10,14 +10,22 @@
 
 #include <lemon/adaptors.h>
 #include <lemon/bfs.h>
-#include <lemon/time_measure.h>
-#include <boost/asio/signal_set.hpp>
+#include <deque>
+#include <chrono>
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
-#include <boost/interprocess/sync/interprocess_semaphore.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/atomic.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 #include "utils.h"
 #include "rootedcladisticancestrygraph.h"
+#include "compactdigraph.h"
+#include "reachabilitybound.h"
+#include "frontierstack.h"
+#include "treestore.h"
+#include "treehashset.h"
+#include "solutionstream.h"
+#include "cancellationtoken.h"
 #include "solution.h"
 #include "solutionset.h"
 
@@ -28,6 +36,23 @@ class RootedCladisticEnumeration
 public:
   DIGRAPH_TYPEDEFS(Digraph);
   
+  /// Progress of a run, from which a later run can continue
+  struct Progress
+  {
+    Progress()
+      : _objectiveValue(0)
+      , _completedTasks()
+      , _trees()
+    {
+    }
+    
+    int _objectiveValue;
+    /// Initial tasks that have been searched exhaustively
+    IntSet _completedTasks;
+    /// Trees of size _objectiveValue found so far
+    TreeStore _trees;
+  };
+  
   RootedCladisticEnumeration(const RootedCladisticAncestryGraph& G,
                              int limit,
                              int timeLimit,
@@ -43,13 +68,26 @@ public:
   
   int solutionCount() const
   {
-    return _result.size();
+    return _solutionCount;
   }
   
+  /// Makes run() return at the next search node, keeping the trees found
+  /// so far. Thread safe
   void stop()
   {
-    _mutex.lock();
-    _threadGroup.interrupt_all();
+    _cancellation.cancel();
+  }
+  
+  /// Stop once token is cancelled, as if stop() had been called
+  void setCancellationToken(const CancellationToken* token)
+  {
+    _cancellation.setParent(token);
+  }
+  
+  /// Returns whether stop() has been called or the token has been cancelled
+  bool cancelled() const
+  {
+    return _cancellation.isCancelled();
   }
   
   Solution solution(int solIdx) const;
@@ -58,10 +96,62 @@ public:
   
   int objectiveValue() const
   {
-    return _objectiveValue;
+    return _objectiveValue.load();
+  }
+  
+  /// Share the lower bound on the tree size with enumerations running
+  /// concurrently, the bound is raised when larger trees are found
+  void setSharedLowerbound(boost::atomic<int>* sharedLowerbound)
+  {
+    _sharedLowerbound = sharedLowerbound;
+  }
+  
+  /// Share the set of trees found with enumerations of other state tree
+  /// combinations, so that a tree is reported only once. Character c is
+  /// identified by charIds[c] in the shared set. Trees found by an
+  /// enumeration with a lower owner are found again, see TreeHashSet
+  void setSharedTrees(TreeHashSet* sharedTrees,
+                      const StlIntVector& charIds,
+                      int owner)
+  {
+    assert(static_cast<int>(charIds.size()) == _G.F().n());
+    _sharedTrees = sharedTrees;
+    _charIds = charIds;
+    _owner = owner;
   }
   
   std::string newick(int solIdx) const;
+  
+  /// Write trees to stream as soon as they are found rather than
+  /// storing them, solution() and newick() are then unavailable
+  void setSolutionStream(SolutionStream* stream)
+  {
+    _solutionStream = stream;
+  }
+  
+  /// Branch first on the frontier arcs whose addition leaves the largest
+  /// upper bound, so that large trees are found early
+  void setBoundOrdered(bool boundOrdered)
+  {
+    _boundOrdered = boundOrdered;
+  }
+  
+  /// Split the search into initial tasks also when running single
+  /// threaded, so that getProgress() reports the completed ones
+  void setCheckpointing(bool checkpointing)
+  {
+    _checkpointing = checkpointing;
+  }
+  
+  /// Returns the progress of the run. Thread safe
+  void getProgress(Progress& progress) const;
+  
+  /// Continues from progress obtained from a run on the same graph,
+  /// must be called after setSharedTrees() and before run()
+  void setProgress(const Progress& progress);
+  
+  /// Returns the canonical forms of the trees found
+  void canonicalTrees(std::vector<TreeHashSet::CanonicalTree>& trees) const;
 
 protected:
   typedef std::list<Arc> ArcList;
@@ -69,21 +159,139 @@ protected:
   typedef ArcList::iterator ArcListNonConstIt;
   typedef ArcList::const_reverse_iterator ArcListRevIt;
   typedef std::vector<ArcList> ArcListVector;
-  typedef std::list<ArcList> ArcListList;
-  typedef lemon::SubDigraph<const Digraph> SubDigraph;
+  typedef CompactSubDigraph SubDigraph;
+  typedef SubDigraph::BitSet BitSet;
   typedef SubDigraph::ArcIt SubArcIt;
   typedef SubDigraph::NodeIt SubNodeIt;
   typedef SubDigraph::OutArcIt SubOutArcIt;
   typedef SubDigraph::InArcIt SubInArcIt;
   typedef Digraph::NodeMap<IntSet> IntSetNodeMap;
+  typedef std::chrono::steady_clock Clock;
+  
+  /// Search frame that can be picked up by any worker thread
+  struct Task
+  {
+    /// Node filter of the partial tree T
+    BitSet _nodesT;
+    /// Arc filter of the partial tree T
+    BitSet _arcsT;
+    /// Node filter of the ancestry graph G
+    BitSet _nodesG;
+    /// Arc filter of the ancestry graph G
+    BitSet _arcsG;
+    /// Frontier
+    ArcList _F;
+    /// Number of arcs at the front of _F that are not branched on
+    size_t _stop;
+    /// Frequency tensor of T (noisy enumeration only)
+    RealTensor _Fhat;
+    /// Initial task this task was split off from, -1 if not tracked
+    int _rootTask;
+  };
+  
+  typedef std::deque<Task> TaskDeque;
+  
+  /// Search node on the explicit stack of grow()
+  struct SearchNode
+  {
+    /// Arc of the child search node currently being explored
+    Arc _a_cidj;
+    /// Number of arcs at the front of the frontier that are not branched on
+    size_t _stop;
+  };
+  
+  typedef std::vector<SearchNode> SearchNodeVector;
+  
+  /// Work space of orderFrontier, kept by grow() for its whole search so
+  /// that the vectors only grow
+  struct OrderBuffers
+  {
+    /// (bound, position) pairs
+    std::vector<IntPair> _scores;
+    /// Arcs of the frontier that are ordered
+    FrontierStack::ArcVector _arcs;
+    /// Frontier after adding an arc
+    FrontierStack::ArcVector _FF;
+  };
+  
+  void runTasks();
+  
+  void worker();
+  
+  /// Returns whether the search was aborted
+  virtual bool runTask(const Task& task);
   
-  virtual void runArc(Arc a_00dj);
+  /// Records that a task split off from rootTask has ended,
+  /// _taskMutex must be held
+  void finishTask(int rootTask, bool aborted);
+  
+  template<typename ArcRange>
+  void initTask(const SubDigraph& subG,
+                const SubDigraph& T,
+                const ArcRange& F,
+                size_t stop,
+                size_t count,
+                Task& task) const
+  {
+    const Digraph& G = _G.G();
+    
+    task._nodesT = T.nodes();
+    task._nodesG = subG.nodes();
+    task._arcsT = T.arcs();
+    task._arcsG = subG.arcs();
+    
+    // the task branches on F[stop, stop + count), the arcs in F[0, stop) are
+    // left to other tasks but may still be used further down the search tree.
+    // the remaining arcs are branched on by the current worker before the
+    // arcs of this task, so these must be excluded.
+    task._F.clear();
+    task._stop = stop;
+    task._rootTask = -1;
+    size_t idx = 0;
+    for (auto it = F.begin(); it != F.end(); ++it, ++idx)
+    {
+      if (idx < stop + count)
+      {
+        task._F.push_back(*it);
+      }
+      else
+      {
+        task._arcsG.reset(G.id(*it));
+      }
+    }
+  }
+  
+  void initSubDigraph(const BitSet& nodes,
+                      const BitSet& arcs,
+                      SubDigraph& S) const
+  {
+    S.nodes() = nodes;
+    S.arcs() = arcs;
+  }
+  
+  void pushTask(const Task& task);
+  
+  /// Returns whether there are more idle workers than pending tasks,
+  /// in which case busy workers should split off part of their frontier
+  bool hasIdleWorkers() const
+  {
+    return _idleWorkers.load(boost::memory_order_relaxed) > _pendingTasks.load(boost::memory_order_relaxed);
+  }
   
   void init(SubDigraph& subG, SubDigraph& T, ArcList& F);
   void init(Arc a_00dj, SubDigraph& subG, SubDigraph& T, ArcList& F);
   
-  bool prune(const SubDigraph& T,
-             const ArcList& F) const;
+  /// Returns whether T cannot be extended to a tree whose size is at least
+  /// the current lower bound, bound must correspond to T and its frontier
+  bool prune(ReachabilityBound& bound) const;
+  
+#ifdef DEBUG
+  /// Returns ReachabilityBound::upperBound for T and frontier [first, last),
+  /// computed from scratch on the graph TT as prune used to
+  int upperBound(const SubDigraph& T,
+                 const Arc* first,
+                 const Arc* last) const;
+#endif
 
   bool isFirstAncestor(const SubDigraph& T,
                        int c,
@@ -173,29 +381,12 @@ protected:
     }
     
     // T is state complete now, final step is to count # char-state pairs in T
-    BoolNodeMap reached(_G.G(), false);
-    lemon::bfs(T).reachedMap(reached).run(_G.root());
+    BitSet reached;
+    T.reached(_G.root(), reached);
     
-    bool nodeRemoved = false;
-    for (NodeIt v_ci(_G.G()); v_ci != lemon::INVALID; ++v_ci)
-    {
-//      if (reached[v_ci])
-//      {
-//        for (const IntPair& ci : _G.nodeToCharState(v_ci))
-//        {
-//          if (stateComplete[ci.first])
-//          {
-//            ++res;
-//          }
-//        }
-//      }
-//      else
-      if (!reached[v_ci] && T.status(v_ci))
-      {
-        T.disable(v_ci);
-        nodeRemoved = true;
-      }
-    }
+    // disable the nodes of T that are no longer reachable from the root
+    bool nodeRemoved = !T.nodes().is_subset_of(reached);
+    T.nodes() &= reached;
     
     int res = 0;
     for (int c = 0; c < n; ++c)
@@ -224,10 +415,55 @@ protected:
   
   bool finalize(SubDigraph& T);
   
+  Solution solution(const SubDigraph& T) const;
+  
+  /// Returns the (char,state) parent/child pairs of state-complete
+  /// tree T in sorted order
+  void canonicalTree(const SubDigraph& T,
+                     TreeHashSet::CanonicalTree& tree) const;
+  
+  /// Sorts the arcs of F past stop by increasing upper bound of T
+  /// extended by the arc, so that the arc with the largest bound is
+  /// branched on first
+  void orderFrontier(const SubDigraph& G,
+                     SubDigraph& T,
+                     FrontierStack& F,
+                     size_t stop,
+                     ReachabilityBound& bound,
+                     OrderBuffers& buffers) const;
+  
+  int getLowerbound() const
+  {
+    if (_sharedLowerbound)
+    {
+      return std::max(_lowerbound.load(), _sharedLowerbound->load());
+    }
+    else
+    {
+      return _lowerbound.load();
+    }
+  }
+  
+  void raiseSharedLowerbound(int size)
+  {
+    if (_sharedLowerbound)
+    {
+      int bound = *_sharedLowerbound;
+      while (bound < size && !_sharedLowerbound->compare_exchange_weak(bound, size));
+    }
+  }
+  
+  void startTimer()
+  {
+    _deadline = Clock::now() + std::chrono::seconds(_timeLimit);
+  }
+  
+  /// Lock free, called at every search node
   bool limitReached() const
   {
-    boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
-    return (_limit != -1 && _counter >= _limit) || (_timeLimit != -1 && _timer.realTime() > _timeLimit);
+    return (_limit != -1 && _solutionCount.load(boost::memory_order_relaxed) >= _limit)
+      || (_timeLimit != -1 && Clock::now() > _deadline)
+      || _cancellation.isCancelled();
   }
   
   struct Compare
@@ -289,7 +525,10 @@ protected:
 private:
   bool grow(SubDigraph& G,
             SubDigraph& T,
-            ArcList& F);
+            const ArcList& F,
+            ReachabilityBound& bound,
+            size_t stop,
+            int rootTask);
   
   virtual bool isValid(const SubDigraph& T) const;
   virtual bool isValid(const SubDigraph& T, Arc a_ciel) const;
@@ -304,34 +543,74 @@ private:
              const StlBoolVector& stateComplete,
              RealMatrix& U) const;
   
-  virtual void initF(int solIdx, RealTensor& F) const
+  virtual void initF(const SubDigraph& T, RealTensor& F) const
   {
     F = _G.F();
   }
   
 protected:
   const RootedCladisticAncestryGraph& _G;
+  /// Compact representation of _G.G() used by the search
+  const CompactDigraph _compactG;
   
-  ArcListList _result;
-  int _objectiveValue;
+  /// Trees of size _objectiveValue found so far
+  TreeStore _result;
+  /// Number of distinct trees of size _objectiveValue found so far
+  boost::atomic<int> _solutionCount;
+  /// If set, trees are written to this stream instead of _result
+  SolutionStream* _solutionStream;
+  boost::atomic<int> _objectiveValue;
   
   int _limit;
   int _timeLimit;
   int _threads;
-  int _lowerbound;
-  int _counter;
-  
+  boost::atomic<int> _lowerbound;
+  boost::atomic<int>* _sharedLowerbound;
+  /// Number of calls to finalize()
+  boost::atomic<int> _counter;
+  
+  /// Trees of the largest size found so far
+  TreeHashSet _trees;
+  TreeHashSet* _sharedTrees;
+  /// Identifier of each character in _sharedTrees
+  StlIntVector _charIds;
+  /// Owner of the trees inserted in _sharedTrees
+  int _owner;
+  
+  /// Guards _result and _solutionCount
   mutable boost::mutex _mutex;
-  boost::interprocess::interprocess_semaphore _sem;
   boost::thread_group _threadGroup;
   
-  lemon::Timer _timer;
+  TaskDeque _tasks;
+  int _activeWorkers;
+  boost::atomic<int> _idleWorkers;
+  boost::atomic<int> _pendingTasks;
+  boost::mutex _taskMutex;
+  boost::condition_variable _taskCondition;
+  /// Number of queued or running tasks of each initial task
+  std::map<int, int> _unfinishedTasks;
+  /// Initial tasks of which a task was aborted
+  IntSet _abortedTasks;
+  /// Initial tasks that have been searched exhaustively, guarded by _mutex
+  IntSet _completedTasks;
+  bool _checkpointing;
+  /// Cancelled by stop() or by the token set by setCancellationToken()
+  CancellationToken _cancellation;
+  
+  /// The time limit expires at _deadline
+  Clock::time_point _deadline;
   bool _monoclonal;
   bool _fixTrunk;
+  bool _boundOrdered;
   
   const IntSet& _whiteList;
 };
   
+std::ostream& operator<<(std::ostream& out,
+                         const RootedCladisticEnumeration::Progress& progress);
+std::istream& operator>>(std::istream& in,
+                         RootedCladisticEnumeration::Progress& progress);
+  
 } // namespace gm
 
 #endif // ROOTEDCLADISTICENUMERATION_H
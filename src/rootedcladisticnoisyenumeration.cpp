@@ -20,7 +20,68 @@ RootedCladisticNoisyEnumeration::RootedCladisticNoisyEnumeration(const RootedCla
   : RootedCladisticEnumeration(G, limit, timeLimit, threads,
                                lowerbound, monoclonal, fixTrunk, whiteList)
   , _noisyG(G)
+  , _nonRootStates(G.F().n())
+  , _descendants(G.F().n(), StlIntMatrix(G.F().k()))
+  , _properDescendants(G.F().n(), StlIntMatrix(G.F().k()))
+  , _isRootFeasible(true)
 {
+  const int n = G.F().n();
+  const int k = G.F().k();
+  
+  for (int c = 0; c < n; ++c)
+  {
+    for (int i = 0; i < k; ++i)
+    {
+      if (G.charStateToNode(c, i) == lemon::INVALID)
+        continue;
+      
+      if (i > 0)
+      {
+        _nonRootStates[c].push_back(i);
+      }
+      
+      const IntSet& D_ci = G.S(c).D(i);
+      for (int j : D_ci)
+      {
+        _descendants[c][i].push_back(j);
+        if (j != i)
+        {
+          _properDescendants[c][i].push_back(j);
+        }
+      }
+    }
+  }
+  
+  RealTensor Fhat;
+  initFhat(Fhat);
+  for (int c = 0; c < n; ++c)
+  {
+    for (int p = 0; p < Fhat.m(); ++p)
+    {
+      double f_hat_p_c0 = Fhat(0, p, c);
+      if (g_tol.less(f_hat_p_c0, 0) || g_tol.less(1, f_hat_p_c0))
+      {
+        _isRootFeasible = false;
+      }
+    }
+  }
+}
+  
+void RootedCladisticNoisyEnumeration::initFhat(RealTensor& Fhat) const
+{
+  Fhat = _noisyG.F_lb();
+  for (int c = 0; c < Fhat.n(); ++c)
+  {
+    for (int p = 0; p < Fhat.m(); ++p)
+    {
+      double sum_of_descendant_states = 0;
+      for (int j : _nonRootStates[c])
+      {
+        sum_of_descendant_states += Fhat(j, p, c);
+      }
+      Fhat.set(0, p, c, 1 - sum_of_descendant_states);
+    }
+  }
 }
   
 void RootedCladisticNoisyEnumeration::init(Arc a_cidj,
@@ -47,7 +108,7 @@ void RootedCladisticNoisyEnumeration::init(Arc a_cidj,
   T.enable(root);
   
   H.clear();
-  Fhat = _noisyG.F_lb();
+  initFhat(Fhat);
   
   // something weird
   if (!updateFhat(T, v_dj, Fhat))
@@ -65,8 +126,11 @@ void RootedCladisticNoisyEnumeration::init(Arc a_cidj,
   {
     for (; aa != lemon::INVALID; ++aa)
     {
-      if (aa != a_cidj && isValid(T, aa))
+      if (aa != a_cidj && checkFhat(T, Fhat, aa))
+      {
+        assert(isValid(T, aa));
         H.push_back(aa);
+      }
     }
   }
 //  else
@@ -148,81 +212,35 @@ bool RootedCladisticNoisyEnumeration::updateFhat(const SubDigraph& T,
 {
   assert(T.status(v_ci));
   
+  const RealTensor& F_lb = _noisyG.F_lb();
+  const RealTensor& F_ub = _noisyG.F_ub();
   const int m = Fhat.m();
   const int n = Fhat.n();
-  const int k = Fhat.k();
+  const Node root = _G.root();
   
-  if (v_ci == _G.root())
+  // set \hat{f}_{p,(c,i)} of the non-root nodes on the path to the root
+  for (Node v = v_ci; v != root; v = T.source(SubInArcIt(T, v)))
   {
-    // set \hat{f}_{p,(c,i)}
-    for (int p = 0; p < m; ++p)
-    {
-      double sum_of_children = 0;
-      for (SubOutArcIt a_cidj(T, v_ci); a_cidj != lemon::INVALID; ++a_cidj)
-      {
-        Node v_dj = T.target(a_cidj);
-        const IntPair& dj = *(_G.nodeToCharState(v_dj).begin());
-        
-        double f_cum_hat_p_dj = Fhat.getCumFreq(p, dj.first, _G.S(dj.first).D(dj.second));
-        sum_of_children += f_cum_hat_p_dj;
-      }
-      
-      for (int c = 0; c < n; ++c)
-      {
-        double sum_of_descendant_states = 0; // proper descendants
-        for (int j = 1; j < k; ++j)
-        {
-          if (_G.charStateToNode(c, j) != lemon::INVALID)
-          {
-            sum_of_descendant_states += Fhat(j, p, c);
-          }
-        }
-        
-        double f_hat_p_ci = 1 - sum_of_descendant_states;
-        if (g_tol.less(f_hat_p_ci, 0) || g_tol.less(1, f_hat_p_ci) || g_tol.less(1, sum_of_children))
-        {
-          return false;
-        }
-        Fhat.set(0, p, c, 1 - sum_of_descendant_states);
-      }
-    }
-    return true;
-  }
-  else
-  {
-    const RealTensor& F_lb = _noisyG.F_lb();
-    const RealTensor& F_ub = _noisyG.F_ub();
-    
-    const auto& X_ci = _G.nodeToCharStateList(v_ci);
+    const auto& X_ci = _G.nodeToCharStateList(v);
     for (auto it_ci = X_ci.rbegin(); it_ci != X_ci.rend(); ++it_ci)
     {
       const IntPair& ci = *it_ci;
+      const StlIntVector& D_ci = _properDescendants[ci.first][ci.second];
       for (int p = 0; p < m; ++p)
       {
         double sum_of_children = 0;
         if (it_ci == X_ci.rbegin())
         {
-          for (SubOutArcIt a_cidj(T, v_ci); a_cidj != lemon::INVALID; ++a_cidj)
-          {
-            Node v_dj = T.target(a_cidj);
-            const IntPair& dj = *(_G.nodeToCharState(v_dj).begin());
-            
-            double f_cum_hat_p_dj = Fhat.getCumFreq(p, dj.first, _G.S(dj.first).D(dj.second));
-            sum_of_children += f_cum_hat_p_dj;
-          }
+          sum_of_children = getSumOfChildren(T, v, p, Fhat);
         }
         else
         {
-          const IntPair& pi_ci = *std::prev(it_ci);
-          sum_of_children = Fhat.getCumFreq(p, pi_ci.first, _G.S(pi_ci.first).D(pi_ci.second));
+          sum_of_children = getCumFhat(p, *std::prev(it_ci), Fhat);
         }
         
         double sum_of_descendant_states = 0; // proper descendants
-        const IntSet& D_ci = _G.S(ci.first).D(ci.second);
-        for (int j = 0; j < k; ++j)
+        for (int j : D_ci)
         {
-          if (j == ci.second) continue;
-          if (D_ci.find(j) == D_ci.end()) continue;
           assert(_G.charStateToNode(ci.first, j) != lemon::INVALID);
           sum_of_descendant_states += Fhat(j, p, ci.first);
         }
@@ -237,10 +255,61 @@ bool RootedCladisticNoisyEnumeration::updateFhat(const SubDigraph& T,
         }
       }
     }
+  }
+  
+  // set \hat{f}_{p,(c,0)}
+  for (int p = 0; p < m; ++p)
+  {
+    if (g_tol.less(1, getSumOfChildren(T, root, p, Fhat)))
+    {
+      return false;
+    }
+  }
+  
+  if (!_isRootFeasible)
+  {
+    for (int c = 0; c < n; ++c)
+    {
+      if (!updateFhatRoot(c, Fhat))
+        return false;
+    }
+    return true;
+  }
+  
+  // root states of characters not on the path are unchanged and
+  // were checked when they were last updated
+  for (Node v = v_ci; v != root; v = T.source(SubInArcIt(T, v)))
+  {
+    for (const IntPair& ci : _G.nodeToCharStateList(v))
+    {
+      if (!updateFhatRoot(ci.first, Fhat))
+        return false;
+    }
+  }
+  
+  return true;
+}
+  
+bool RootedCladisticNoisyEnumeration::updateFhatRoot(int c,
+                                                     RealTensor& Fhat) const
+{
+  for (int p = 0; p < Fhat.m(); ++p)
+  {
+    double sum_of_descendant_states = 0; // proper descendants
+    for (int j : _nonRootStates[c])
+    {
+      sum_of_descendant_states += Fhat(j, p, c);
+    }
     
-    // recurse
-    return updateFhat(T, T.source(SubInArcIt(T, v_ci)), Fhat);
+    double f_hat_p_c0 = 1 - sum_of_descendant_states;
+    if (g_tol.less(f_hat_p_c0, 0) || g_tol.less(1, f_hat_p_c0))
+    {
+      return false;
+    }
+    Fhat.set(0, p, c, f_hat_p_c0);
   }
+  
+  return true;
 }
   
 void RootedCladisticNoisyEnumeration::init(SubDigraph& subG,
@@ -250,20 +319,7 @@ void RootedCladisticNoisyEnumeration::init(SubDigraph& subG,
 {
   RootedCladisticEnumeration::init(subG, T, H);
   
-  Fhat = _noisyG.F_lb();
-  for (int c = 0; c < Fhat.n(); ++c)
-  {
-    for (int p = 0; p < Fhat.m(); ++p)
-    {
-      double fhat_p_c0 = 0;
-      for (int i = 1; i < Fhat.k(); ++i)
-      {
-        fhat_p_c0 += Fhat(i, p, c);
-      }
-      fhat_p_c0 = 1 - fhat_p_c0;
-      Fhat.set(0, p, c, fhat_p_c0);
-    }
-  }
+  initFhat(Fhat);
   
 #ifdef DEBUG
   RealTensor Fhat2 = _noisyG.F_lb();
@@ -277,8 +333,13 @@ void RootedCladisticNoisyEnumeration::run()
   const Digraph& G = _G.G();
   Node root = _G.root();
   
-  _timer.start();
+  startTimer();
   _counter = 0;
+  if (g_verbosity >= VERBOSE_ESSENTIAL && !_completedTasks.empty())
+  {
+    std::cerr << "Skipping " << _completedTasks.size() << " completed root tasks" << std::endl;
+  }
+  
 //  if (_threads == 1)
 //  {
 //    BoolNodeMap filterNodesT(G, false);
@@ -298,20 +359,41 @@ void RootedCladisticNoisyEnumeration::run()
 //  else
   if (!_monoclonal)
   {
-    BoolNodeMap filterNodesT(G, false);
-    BoolArcMap filterArcsT(G, false);
-    SubDigraph T(G, filterNodesT, filterArcsT);
-    filterNodesT[root] = true;
+    SubDigraph T(_compactG, false);
+    T.enable(root);
     
-    BoolNodeMap filterNodesG(G, true);
-    BoolArcMap filterArcsG(G, true);
-    SubDigraph subG(G, filterNodesG, filterArcsG);
+    SubDigraph subG(_compactG, true);
     
     ArcList H;
     RealTensor Fhat;
     
     init(subG, T, H, Fhat);
-    grow(subG, T, H, Fhat);
+    if (H.empty() || (_threads == 1 && !_checkpointing))
+    {
+      ReachabilityBound bound(_G, _compactG, _whiteList);
+      bound.init(T, H);
+      grow(subG, T, H, Fhat, bound, 0, -1);
+    }
+    else
+    {
+      // partition on the first arc from H: task i branches on H[i] only,
+      // keeping H[0, i) as frontier and excluding H(i, |H|) like grow does.
+      // tasks are queued in the order in which grow would process them.
+      int rootTask = 0;
+      for (size_t i = H.size(); i > 0; --i, ++rootTask)
+      {
+        if (_completedTasks.count(rootTask))
+          continue;
+        
+        Task task;
+        initTask(subG, T, H, i - 1, 1, task);
+        task._Fhat = Fhat;
+        task._rootTask = rootTask;
+        pushTask(task);
+      }
+      
+      runTasks();
+    }
   }
   if (_monoclonal && _fixTrunk)
   {
@@ -319,21 +401,23 @@ void RootedCladisticNoisyEnumeration::run()
     OutArcIt a_00ci(G, root);
     Node v_ci = G.target(a_00ci);
     
-    for (OutArcIt a_cidj(G, v_ci); a_cidj != lemon::INVALID; ++a_cidj)
+    int rootTask = 0;
+    for (OutArcIt a_cidj(G, v_ci); a_cidj != lemon::INVALID; ++a_cidj, ++rootTask)
     {
-      _threadGroup.create_thread(boost::bind(&RootedCladisticNoisyEnumeration::runArc, this, a_cidj));
+      addTask(a_cidj, rootTask);
     }
     
-    _threadGroup.join_all();
+    runTasks();
   }
   else if (_monoclonal)
   {
-    for (OutArcIt a_00dj(G, root); a_00dj != lemon::INVALID; ++a_00dj)
+    int rootTask = 0;
+    for (OutArcIt a_00dj(G, root); a_00dj != lemon::INVALID; ++a_00dj, ++rootTask)
     {
-      _threadGroup.create_thread(boost::bind(&RootedCladisticNoisyEnumeration::runArc, this, a_00dj));
+      addTask(a_00dj, rootTask);
     }
     
-    _threadGroup.join_all();
+    runTasks();
   }
   
   if (g_verbosity >= VERBOSE_ESSENTIAL)
@@ -342,26 +426,37 @@ void RootedCladisticNoisyEnumeration::run()
   }
 }
   
-void RootedCladisticNoisyEnumeration::runArc(Arc a_00dj)
+void RootedCladisticNoisyEnumeration::addTask(Arc a_cidj, int rootTask)
 {
-  _sem.wait();
-  const Digraph& G = _G.G();
-  
-  BoolNodeMap filterNodesT(G, false);
-  BoolArcMap filterArcsT(G, false);
-  SubDigraph T(G, filterNodesT, filterArcsT);
+  if (_completedTasks.count(rootTask))
+    return;
   
-  BoolNodeMap filterNodesG(G, true);
-  BoolArcMap filterArcsG(G, true);
-  SubDigraph subG(G, filterNodesG, filterArcsG);
+  SubDigraph T(_compactG, false);
+  SubDigraph subG(_compactG, true);
   
   ArcList H;
-  RealTensor Fhat;
+  Task task;
+  
+  init(a_cidj, subG, T, H, task._Fhat);
+  initTask(subG, T, H, 0, H.size(), task);
+  task._rootTask = rootTask;
+  pushTask(task);
+}
   
-  init(a_00dj, subG, T, H, Fhat);
-  grow(subG, T, H, Fhat);
+bool RootedCladisticNoisyEnumeration::runTask(const Task& task)
+{
+  SubDigraph T(_compactG, false);
+  initSubDigraph(task._nodesT, task._arcsT, T);
   
-  _sem.post();
+  SubDigraph subG(_compactG, true);
+  initSubDigraph(task._nodesG, task._arcsG, subG);
+  
+  ArcList H = task._F;
+  RealTensor Fhat = task._Fhat;
+  
+  ReachabilityBound bound(_G, _compactG, _whiteList);
+  bound.init(T, H);
+  return grow(subG, T, H, Fhat, bound, task._stop, task._rootTask);
 }
   
 //void RootedCladisticNoisyEnumeration::run()
@@ -437,143 +532,171 @@ void RootedCladisticNoisyEnumeration::writeDOT(std::ostream& out,
   
 bool RootedCladisticNoisyEnumeration::grow(SubDigraph& G,
                                            SubDigraph& T,
-                                           ArcList& H,
-                                           RealTensor& Fhat)
+                                           const ArcList& H_init,
+                                           RealTensor& Fhat,
+                                           ReachabilityBound& bound,
+                                           size_t stop,
+                                           int rootTask)
 {
   // TODO: make monoclonal work when single-threaded
-  if (limitReached())
-  {
-    return true;
-  }
-  else if (H.empty())
-  {
-    return finalize(T);
-  }
-  else if (prune(T, H))
-  {
-    return false;
-  }
-  else
+  
+  // depth-first search using an explicit stack, the frontier of each
+  // search node on the stack is on the frontier stack
+  FrontierStack H;
+  H.push(H_init.begin(), H_init.end());
+  SearchNodeVector path;
+  OrderBuffers buffers;
+  
+  while (true)
   {
-    ArcList HH;
+    bool expand = false;
+    if (limitReached())
+    {
+      return true;
+    }
+    else if (H.empty())
+    {
+      if (finalize(T))
+        return true;
+    }
+    else if (!prune(bound))
+    {
+      expand = true;
+    }
     
-    do
+    if (expand)
     {
-      assert(!H.empty());
-      
-      Arc a_cidj = H.back();
-      H.pop_back();
-      
-      const Node v_ci = G.source(a_cidj);
-      const Node v_dj = G.target(a_cidj);
+      SearchNode node;
+      node._a_cidj = lemon::INVALID;
+      node._stop = path.empty() ? stop : 0;
+      path.push_back(node);
       
-      assert(T.status(v_ci));
-      assert(!T.status(v_dj));
-      assert(!T.status(a_cidj));
-      
-      // add a_cidj to T
-      assert(isValid(T, a_cidj));
-      addArc(T, Fhat, a_cidj);
-      
-      ArcList newH = H;
-      
-      // remove each arc wv where w in T from F
-      for (ArcListNonConstIt it = newH.begin(); it != newH.end();)
+      if (_boundOrdered)
       {
-        Arc a_elfs = *it;
-        Node v_el = G.source(a_elfs);
-        Node v_fs = G.target(a_elfs);
-        if (T.status(v_fs))
-        {
-          it = newH.erase(it);
-        }
-        else if (v_fs == v_dj)
-        {
-          assert(T.status(v_el));
-          it = newH.erase(it);
-        }
-        else if (!checkFhat(T, Fhat, a_elfs))
-        {
-          it = newH.erase(it);
-        }
-        else
-        {
-//          if (!isValid(T, a_elfs))
-//          {
-//            RootedCladisticEnumeration::writeDOT(std::cout, T, HH);
-//          }
-          assert(checkFhat(T, Fhat, *it));
-          assert(isValid(T, *it));
-          ++it;
-        }
+        orderFrontier(G, T, H, node._stop, bound, buffers);
       }
-      
-      // push each arc a_djel where v_el not in V(T) onto F
-      for (SubOutArcIt a_djel(G, v_dj); a_djel != lemon::INVALID; ++a_djel)
+    }
+    else
+    {
+      // backtrack to the deepest search node with arcs left to branch on
+      H.pop();
+      while (!path.empty())
       {
-        Node v_el = G.target(a_djel);
-        
-        // violation of tree constraint (no cycles)
-        if (T.status(v_el))
-          continue;
-        
-        // isFirstAncestor violation (consistency)
-        bool isConsistent = true;
-        for (const IntPair& el : _G.nodeToCharState(v_el))
-        {
-          int pi_l = _G.S(el.first).parent(el.second);
-          assert(0 <= pi_l && pi_l < Fhat.k());
-          Node v_e_pi_l = _G.charStateToNode(el.first, pi_l);
-
-          isConsistent = isConsistent && isFirstAncestor(T, el.first, v_e_pi_l, v_dj);
-        }
+        const SearchNode& node = path.back();
+        bound.pop();
+        G.disable(node._a_cidj);
+        removeArc(T, Fhat, node._a_cidj);
+#ifdef DEBUG
+        assert(bound.upperBound() == upperBound(T, H.begin(), H.removedEnd()));
+#endif
         
-        if (!isConsistent)
-          continue;
+        if (H.size() > node._stop)
+          break;
         
-        if (checkFhat(T, Fhat, a_djel))
+        for (const Arc* it = H.end(); it != H.removedEnd(); ++it)
         {
-          assert(isValid(T, a_djel));
-          newH.push_back(a_djel);
+          Arc a = *it;
+          assert(!G.status(a));
+          G.enable(a);
         }
+        H.restore();
+        H.pop();
+        path.pop_back();
       }
       
-      // shuffle frontier, depth-first is overrated
-      if (_monoclonal)
+      if (path.empty())
+        return false;
+    }
+    
+    SearchNode& node = path.back();
+    assert(H.size() > node._stop);
+    
+    // hand the front half of our frontier to idle workers
+    if (_threads > 1 && H.size() - node._stop > 1 && hasIdleWorkers())
+    {
+      size_t count = (H.size() - node._stop) / 2;
+      Task task;
+      initTask(G, T, H, node._stop, count, task);
+      task._Fhat = Fhat;
+      task._rootTask = rootTask;
+      pushTask(task);
+      node._stop += count;
+    }
+    
+    Arc a_cidj = H.back();
+    H.pop_back();
+    node._a_cidj = a_cidj;
+    
+    const Node v_ci = G.source(a_cidj);
+    const Node v_dj = G.target(a_cidj);
+    
+    assert(T.status(v_ci));
+    assert(!T.status(v_dj));
+    assert(!T.status(a_cidj));
+    
+    // add a_cidj to T
+    assert(isValid(T, a_cidj));
+    addArc(T, Fhat, a_cidj);
+    
+    H.push();
+    
+    // remove each arc wv where w in T from F
+    size_t size = 0;
+    for (size_t idx = 0; idx < H.size(); ++idx)
+    {
+      Arc a_elfs = H[idx];
+      Node v_el = G.source(a_elfs);
+      Node v_fs = G.target(a_elfs);
+      assert(v_fs != v_dj || T.status(v_el));
+      if (!T.status(v_fs) && v_fs != v_dj && checkFhat(T, Fhat, a_elfs))
       {
-        // why??? don't tell anyone. gryte made me do it.
-        std::vector<Arc> tmpVec;
-        tmpVec.insert(tmpVec.begin(), newH.begin(), newH.end());
-        std::shuffle(tmpVec.begin(), tmpVec.end(), g_rng);
-        newH.clear();
-        for (Arc a : tmpVec)
-        {
-          newH.push_back(a);
-        }
+        assert(isValid(T, a_elfs));
+        H[size++] = a_elfs;
       }
+    }
+    H.resize(size);
+    
+    // push each arc a_djel where v_el not in V(T) onto F
+    for (SubOutArcIt a_djel(G, v_dj); a_djel != lemon::INVALID; ++a_djel)
+    {
+      Node v_el = G.target(a_djel);
       
-//      RootedCladisticEnumeration::writeDOT(std::cout, T, newH);
+      // violation of tree constraint (no cycles)
+      if (T.status(v_el))
+        continue;
       
-      if (grow(G, T, newH, Fhat))
-        return true;
-      
-      G.disable(a_cidj);
+      // isFirstAncestor violation (consistency)
+      bool isConsistent = true;
+      for (const IntPair& el : _G.nodeToCharState(v_el))
+      {
+        int pi_l = _G.S(el.first).parent(el.second);
+        assert(0 <= pi_l && pi_l < Fhat.k());
+        Node v_e_pi_l = _G.charStateToNode(el.first, pi_l);
+        
+        isConsistent = isConsistent && isFirstAncestor(T, el.first, v_e_pi_l, v_dj);
+      }
       
-      removeArc(T, Fhat, a_cidj);
+      if (!isConsistent)
+        continue;
       
-      HH.push_back(a_cidj);
-    } while (!H.empty());
+      if (checkFhat(T, Fhat, a_djel))
+      {
+        assert(isValid(T, a_djel));
+        H.push_back(a_djel);
+      }
+    }
     
-    for (ArcListRevIt it = HH.rbegin(); it != HH.rend(); ++it)
+    // shuffle frontier, depth-first is overrated
+    if (_monoclonal)
     {
-      Arc a = *it;
-      assert(!G.status(a));
-      
-      H.push_back(*it);
-      G.enable(a);
+      // why??? don't tell anyone. gryte made me do it.
+      std::shuffle(H.begin(), H.end(), g_rng);
     }
     
-    return false;
+    bound.push(a_cidj, H);
+#ifdef DEBUG
+    assert(bound.upperBound() == upperBound(T, H.begin(), H.end()));
+#endif
   }
 }
   
@@ -591,13 +714,11 @@ bool RootedCladisticNoisyEnumeration::isValid(const SubDigraph& T,
   assert(!T.status(a_cidj));
   assert(!T.status(T.target(a_cidj)));
   
-  T.enable(a_cidj);
-  T.enable(T.target(a_cidj));
+  SubDigraph TT(T);
+  TT.enable(a_cidj);
+  TT.enable(TT.target(a_cidj));
   
-  bool res = isValid(T);
-  T.disable(a_cidj);
-  T.disable(T.target(a_cidj));
-  return res;
+  return isValid(TT);
 }
   
 bool RootedCladisticNoisyEnumeration::isValid(const SubDigraph& T,
@@ -43,8 +43,11 @@ protected:
 private:
   bool grow(SubDigraph& G,
             SubDigraph& T,
-            ArcList& H,
-            RealTensor& Fhat);
+            const ArcList& H,
+            RealTensor& Fhat,
+            ReachabilityBound& bound,
+            size_t stop,
+            int rootTask);
    
   void writeDOT(std::ostream& out,
                 const SubDigraph& T,
@@ -60,10 +63,52 @@ private:
             ArcList& H,
             RealTensor& Fhat);
   
+  /// Sets Fhat to the lower bounds, with the root states taking the
+  /// remaining frequency
+  void initFhat(RealTensor& Fhat) const;
+  
+  /// Updates \hat{f} along the path from v_ci to the root,
+  /// only root states of characters on this path are updated
   bool updateFhat(const SubDigraph& T,
                   Node v_ci,
                   RealTensor& Fhat) const;
   
+  /// Updates \hat{f} of the root state of character c
+  bool updateFhatRoot(int c, RealTensor& Fhat) const;
+  
+  /// Returns \hat{f} summed over the first states of the children of v_ci
+  /// and their descendant states
+  double getSumOfChildren(const SubDigraph& T,
+                          Node v_ci,
+                          int p,
+                          const RealTensor& Fhat) const
+  {
+    double sum_of_children = 0;
+    for (SubOutArcIt a_cidj(T, v_ci); a_cidj != lemon::INVALID; ++a_cidj)
+    {
+      Node v_dj = T.target(a_cidj);
+      const IntPair& dj = *(_G.nodeToCharState(v_dj).begin());
+      
+      sum_of_children += getCumFhat(p, dj, Fhat);
+    }
+    return sum_of_children;
+  }
+  
+  /// Returns \hat{f} summed over state dj and its descendant states
+  double getCumFhat(int p,
+                    const IntPair& dj,
+                    const RealTensor& Fhat) const
+  {
+    double res = 0;
+    for (int l : _descendants[dj.first][dj.second])
+    {
+      res += Fhat(l, p, dj.first);
+    }
+    return res;
+  }
+  
+  /// Checks whether a_cidj can be added to T, by updating Fhat along the
+  /// path from the target of a_cidj to the root and rolling back afterwards
   bool checkFhat(SubDigraph& T,
                  RealTensor& Fhat,
                  Arc a_cidj) const;
@@ -80,31 +125,12 @@ private:
                Node v_ci,
                RealTensor& F_hat) const;
   
-  virtual void runArc(Arc a_00dj);
+  virtual bool runTask(const Task& task);
   
-  void initF(int solIdx, RealTensor& F) const
+  void addTask(Arc a_cidj, int rootTask);
+  
+  void initF(const SubDigraph& T, RealTensor& F) const
   {
-    const Digraph& G = _G.G();
-    
-    BoolNodeMap filterNodesT(G, false);
-    BoolArcMap filterArcsT(G, false);
-    
-    SubDigraph T(G, filterNodesT, filterArcsT);
-    
-    ArcListList::const_iterator it = _result.begin();
-    int tmp = solIdx;
-    for (; tmp > 0; --tmp, ++it);
-    const ArcList& arcs = *it;
-    for (ArcListIt it = arcs.begin(); it != arcs.end(); ++it)
-    {
-      Arc a_cidj = *it;
-      Node v_ci = G.source(a_cidj);
-      Node v_dj = G.target(a_cidj);
-      T.enable(v_ci);
-      T.enable(v_dj);
-      T.enable(a_cidj);
-    }
-    
     isValid(T, _G.root(), F);
 
     for (int p = 0; p < F.m(); ++p)
@@ -119,6 +145,15 @@ private:
   
 private:
   const RootedCladisticNoisyAncestryGraph& _noisyG;
+  /// Present non-root states of each character, in increasing order
+  StlIntMatrix _nonRootStates;
+  /// Descendant states of each state (c,i), including i, in increasing order
+  std::vector<StlIntMatrix> _descendants;
+  /// Proper descendant states of each state (c,i), in increasing order
+  std::vector<StlIntMatrix> _properDescendants;
+  /// Whether the root states are within [0,1] at the lower bounds,
+  /// if not the root states of all characters are checked on every update
+  bool _isRootFeasible;
 };
   
 } // namespace gm
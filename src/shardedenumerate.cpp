@@ -0,0 +1,506 @@
+/*
+ * shardedenumerate.cpp
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#include "shardedenumerate.h"
+#include "noisycnaenumerate.h"
+#include <boost/thread.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <sstream>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace gm {
+
+ShardedEnumerate::ShardedEnumerate(const CharacterMatrix& M,
+                                   const StlDoubleVector& purityValues,
+                                   const CompatibilityGraph& comp,
+                                   int lowerbound)
+  : _M(M)
+  , _purityValues(purityValues)
+  , _comp(comp)
+  , _lowerbound(lowerbound)
+  , _boundOrdered(false)
+  , _cancellationToken(NULL)
+  , _cancelled(false)
+  , _workers()
+  , _nextCombination(0)
+  , _endCombination(0)
+  , _rangeSize(1)
+  , _treeSizeBound(lowerbound)
+  , _treeSize(0)
+  , _sols()
+  , _resultMutex()
+{
+}
+
+void ShardedEnumerate::enumerate(int workers,
+                                 int limit,
+                                 int timeLimit,
+                                 int threads,
+                                 int state_tree_limit,
+                                 bool monoclonal,
+                                 int offset,
+                                 const IntSet& whiteList)
+{
+  _sols.clear();
+  _treeSize = 0;
+  _treeSizeBound = _lowerbound;
+  _cancelled = false;
+  _workers.clear();
+  
+  const int combinations = _comp.combinations();
+  _nextCombination = offset;
+  _endCombination = state_tree_limit == -1 ? combinations : std::min(combinations, offset + state_tree_limit);
+  
+  const int nrCombinations = _endCombination - _nextCombination;
+  if (nrCombinations <= 0)
+    return;
+  
+  // hand out several ranges to each worker, so that the load stays balanced
+  // when some combinations take much longer than others
+  workers = std::min(workers, nrCombinations);
+  _rangeSize = std::max(1, nrCombinations / (RANGES_PER_WORKER * workers));
+  
+  // a worker that exits closes its pipes, which is detected by poll
+  signal(SIGPIPE, SIG_IGN);
+  
+  try
+  {
+    for (int i = 0; i < workers; ++i)
+    {
+      Worker worker;
+      spawn(limit, timeLimit, threads, monoclonal, whiteList, worker);
+      _workers.push_back(worker);
+    }
+    
+    for (Worker& worker : _workers)
+    {
+      assign(worker);
+    }
+    
+    char buffer[65536];
+    while (true)
+    {
+      std::vector<pollfd> fds;
+      StlIntVector workerIdx;
+      for (int idx = 0; idx < _workers.size(); ++idx)
+      {
+        if (_workers[idx]._active)
+        {
+          pollfd fd;
+          fd.fd = _workers[idx]._resultFd;
+          fd.events = POLLIN;
+          fd.revents = 0;
+          fds.push_back(fd);
+          workerIdx.push_back(idx);
+        }
+      }
+      if (fds.empty())
+        break;
+      
+      if (!_cancelled && _cancellationToken && _cancellationToken->isCancelled())
+      {
+        // the workers send the trees found so far, and are then stopped
+        _cancelled = true;
+        for (Worker& worker : _workers)
+        {
+          if (worker._active)
+          {
+            writeAll(worker._boundFd, "cancel\n");
+          }
+        }
+      }
+      
+      // wake up regularly to check the cancellation token
+      const int timeout = _cancellationToken && !_cancelled ? BOUND_POLL_INTERVAL : -1;
+      if (poll(fds.data(), fds.size(), timeout) < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        throw std::runtime_error("Error: unable to poll workers");
+      }
+      
+      for (int j = 0; j < fds.size(); ++j)
+      {
+        if (fds[j].revents == 0)
+          continue;
+        
+        Worker& worker = _workers[workerIdx[j]];
+        ssize_t size = read(worker._resultFd, buffer, sizeof(buffer));
+        if (size < 0 && errno == EINTR)
+          continue;
+        if (size <= 0)
+        {
+          std::stringstream ss;
+          ss << "Error: worker " << worker._pid << " exited unexpectedly";
+          throw std::runtime_error(ss.str());
+        }
+        
+        worker._buffer.append(buffer, size);
+        process(workerIdx[j]);
+      }
+    }
+  }
+  catch (std::runtime_error&)
+  {
+    reap(true);
+    throw;
+  }
+  
+  if (!reap(false))
+  {
+    throw std::runtime_error("Error: worker exited abnormally");
+  }
+  
+  _sols.unique();
+}
+
+void ShardedEnumerate::spawn(int limit,
+                             int timeLimit,
+                             int threads,
+                             bool monoclonal,
+                             const IntSet& whiteList,
+                             Worker& worker)
+{
+  int commandPipe[2], boundPipe[2], resultPipe[2];
+  if (pipe(commandPipe) != 0 || pipe(boundPipe) != 0 || pipe(resultPipe) != 0)
+  {
+    throw std::runtime_error("Error: unable to create pipes");
+  }
+  
+  // buffered output would otherwise be written by the worker as well
+  std::cout.flush();
+  std::cerr.flush();
+  
+  pid_t pid = ::fork();
+  if (pid == -1)
+  {
+    throw std::runtime_error("Error: unable to fork worker");
+  }
+  
+  if (pid == 0)
+  {
+    // the coordinator asks the worker to stop
+    signal(SIGINT, SIG_IGN);
+    signal(SIGTERM, SIG_IGN);
+    
+    close(commandPipe[1]);
+    close(boundPipe[1]);
+    close(resultPipe[0]);
+    
+    // the pipes of the other workers must only be open in the coordinator,
+    // otherwise closing them does not signal the end of the input
+    for (const Worker& other : _workers)
+    {
+      close(other._commandFd);
+      close(other._boundFd);
+      close(other._resultFd);
+    }
+    
+    runWorker(commandPipe[0], boundPipe[0], resultPipe[1],
+              limit, timeLimit, threads, monoclonal, whiteList);
+  }
+  
+  close(commandPipe[0]);
+  close(boundPipe[0]);
+  close(resultPipe[1]);
+  
+  worker._pid = pid;
+  worker._commandFd = commandPipe[1];
+  worker._boundFd = boundPipe[1];
+  worker._resultFd = resultPipe[0];
+  worker._buffer.clear();
+  worker._active = true;
+}
+
+void ShardedEnumerate::runWorker(int commandFd,
+                                 int boundFd,
+                                 int resultFd,
+                                 int limit,
+                                 int timeLimit,
+                                 int threads,
+                                 bool monoclonal,
+                                 const IntSet& whiteList)
+{
+  NoisyCnaEnumerate alg(_M, _purityValues, _comp, _lowerbound);
+  alg.init(-1);
+  alg.setBoundOrdered(_boundOrdered);
+  
+  CancellationToken cancellation;
+  alg.setCancellationToken(&cancellation);
+  
+  boost::thread boundThread(boost::bind(&ShardedEnumerate::boundWorker, this,
+                                        boost::ref(alg), boost::ref(cancellation),
+                                        boundFd, resultFd));
+  
+  std::string line;
+  while (readLine(commandFd, line))
+  {
+    std::stringstream ss(line);
+    std::string command;
+    int offset = -1, count = -1;
+    ss >> command >> offset >> count;
+    if (command == "stop")
+      break;
+    if (command != "range" || offset < 0 || count <= 0)
+    {
+      std::cerr << "Error: invalid command '" << line << "'" << std::endl;
+      _exit(1);
+    }
+    
+    alg.enumerate(limit, timeLimit, threads, count, monoclonal, offset, whiteList);
+    
+    // an empty solution set cannot be read back, it is sent as no data
+    std::stringstream data;
+    if (alg.sols().solutionCount() > 0)
+    {
+      data << alg.sols();
+    }
+    
+    std::stringstream header;
+    header << "sols " << alg.treeSize() << " " << data.str().size() << std::endl;
+    
+    boost::interprocess::scoped_lock<boost::mutex> lock(_resultMutex);
+    if (!writeAll(resultFd, header.str()) || !writeAll(resultFd, data.str()))
+    {
+      // the coordinator is gone
+      _exit(1);
+    }
+  }
+  
+  // the coordinator closes the bound pipe when it stops this worker
+  boundThread.join();
+  _exit(0);
+}
+
+void ShardedEnumerate::boundWorker(NoisyCnaEnumerate& alg,
+                                   CancellationToken& cancellation,
+                                   int boundFd,
+                                   int resultFd)
+{
+  int sentBound = alg.treeSizeBound();
+  
+  pollfd fd;
+  fd.fd = boundFd;
+  fd.events = POLLIN;
+  while (true)
+  {
+    fd.revents = 0;
+    int ret = poll(&fd, 1, BOUND_POLL_INTERVAL);
+    if (ret < 0 && errno != EINTR)
+      break;
+    
+    if (ret > 0)
+    {
+      std::string line;
+      if (!readLine(boundFd, line))
+        break;
+      
+      if (line == "cancel")
+      {
+        cancellation.cancel();
+        continue;
+      }
+      
+      int bound = -1;
+      std::stringstream ss(line);
+      ss >> bound;
+      alg.raiseTreeSizeBound(bound);
+      sentBound = std::max(sentBound, bound);
+    }
+    
+    const int bound = alg.treeSizeBound();
+    if (bound > sentBound)
+    {
+      std::stringstream ss;
+      ss << "bound " << bound << std::endl;
+      
+      boost::interprocess::scoped_lock<boost::mutex> lock(_resultMutex);
+      writeAll(resultFd, ss.str());
+      sentBound = bound;
+    }
+  }
+}
+
+void ShardedEnumerate::assign(Worker& worker)
+{
+  if (!_cancelled && _nextCombination < _endCombination)
+  {
+    const int count = std::min(_rangeSize, _endCombination - _nextCombination);
+    
+    std::stringstream ss;
+    ss << "range " << _nextCombination << " " << count << std::endl;
+    if (!writeAll(worker._commandFd, ss.str()))
+    {
+      throw std::runtime_error("Error: unable to send range to worker");
+    }
+    
+    if (g_verbosity >= VERBOSE_ESSENTIAL)
+    {
+      std::cerr << "Worker " << worker._pid << ": combinations "
+                << _nextCombination + 1 << "-" << _nextCombination + count
+                << "/" << _comp.combinations() << std::endl;
+    }
+    
+    _nextCombination += count;
+  }
+  else
+  {
+    stop(worker);
+  }
+}
+
+void ShardedEnumerate::process(int idx)
+{
+  Worker& worker = _workers[idx];
+  while (worker._active)
+  {
+    const size_t pos = worker._buffer.find('\n');
+    if (pos == std::string::npos)
+      return;
+    
+    const std::string line = worker._buffer.substr(0, pos);
+    std::stringstream ss(line);
+    std::string message;
+    ss >> message;
+    
+    if (message == "bound")
+    {
+      int bound = -1;
+      ss >> bound;
+      worker._buffer.erase(0, pos + 1);
+      
+      if (bound > _treeSizeBound)
+      {
+        _treeSizeBound = bound;
+        
+        std::stringstream out;
+        out << bound << std::endl;
+        for (int i = 0; i < _workers.size(); ++i)
+        {
+          // a worker that has exited is detected when reading its results
+          if (i != idx && _workers[i]._active)
+          {
+            writeAll(_workers[i]._boundFd, out.str());
+          }
+        }
+      }
+    }
+    else if (message == "sols")
+    {
+      int treeSize = -1;
+      size_t size = 0;
+      ss >> treeSize >> size;
+      if (worker._buffer.size() < pos + 1 + size)
+        return;
+      
+      std::stringstream data(worker._buffer.substr(pos + 1, size));
+      worker._buffer.erase(0, pos + 1 + size);
+      
+      if (size > 0)
+      {
+        SolutionSet sols;
+        g_lineNumber = 0;
+        data >> sols;
+        merge(treeSize, sols);
+      }
+      
+      assign(worker);
+    }
+    else
+    {
+      throw std::runtime_error("Error: invalid message '" + line + "' from worker");
+    }
+  }
+}
+
+void ShardedEnumerate::merge(int treeSize, const SolutionSet& sols)
+{
+  if (treeSize >= _treeSize)
+  {
+    if (treeSize > _treeSize)
+    {
+      _treeSize = treeSize;
+      _sols.clear();
+    }
+    
+    _sols.add(sols);
+  }
+}
+
+void ShardedEnumerate::stop(Worker& worker)
+{
+  writeAll(worker._commandFd, "stop\n");
+  
+  close(worker._commandFd);
+  close(worker._boundFd);
+  close(worker._resultFd);
+  worker._active = false;
+}
+
+bool ShardedEnumerate::reap(bool kill)
+{
+  bool ok = true;
+  for (Worker& worker : _workers)
+  {
+    if (worker._active)
+    {
+      if (kill)
+      {
+        // workers ignore SIGTERM, they are only stopped by the coordinator
+        ::kill(worker._pid, SIGKILL);
+      }
+      close(worker._commandFd);
+      close(worker._boundFd);
+      close(worker._resultFd);
+      worker._active = false;
+    }
+    
+    int status = 0;
+    if (waitpid(worker._pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+bool ShardedEnumerate::readLine(int fd, std::string& line)
+{
+  line.clear();
+  char c;
+  while (true)
+  {
+    ssize_t size = read(fd, &c, 1);
+    if (size < 0 && errno == EINTR)
+      continue;
+    if (size <= 0)
+      return false;
+    if (c == '\n')
+      return true;
+    line += c;
+  }
+}
+
+bool ShardedEnumerate::writeAll(int fd, const std::string& data)
+{
+  size_t written = 0;
+  while (written < data.size())
+  {
+    ssize_t size = write(fd, data.data() + written, data.size() - written);
+    if (size < 0 && errno == EINTR)
+      continue;
+    if (size <= 0)
+      return false;
+    written += size;
+  }
+  return true;
+}
+
+} // namespace gm
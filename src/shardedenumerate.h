@@ -0,0 +1,177 @@
+/*
+ * shardedenumerate.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef SHARDEDENUMERATE_H
+#define SHARDEDENUMERATE_H
+
+#include "charactermatrix.h"
+#include "solutionset.h"
+#include "compatibilitygraph.h"
+#include "cancellationtoken.h"
+#include <sys/types.h>
+#include <boost/thread/mutex.hpp>
+
+namespace gm {
+
+class NoisyCnaEnumerate;
+
+/// Enumeration of the state tree combinations by several worker processes
+///
+/// The coordinator forks the workers, which share the character matrix and
+/// the compatibility graph with it. Each worker runs a NoisyCnaEnumerate on
+/// the ranges of combinations handed out by the coordinator. Whenever a
+/// worker raises its lower bound on the tree size, the coordinator passes
+/// the new bound on to the other workers. The solutions of all ranges are
+/// merged as by merge: only the largest trees are retained and duplicates
+/// are removed. The size of a tree is the number of characters reported by
+/// the worker, as in a single process enumeration, rather than the number
+/// of vertices used by merge.
+///
+/// The coordinator and a worker communicate over three pipes. The command
+/// pipe carries 'range <offset> <count>' and 'stop' lines to the worker,
+/// the bound pipe carries tree sizes and 'cancel' lines to the worker and the result pipe
+/// carries 'bound <size>' lines and 'sols <tree size> <bytes>' lines,
+/// followed by the solutions of a range in SolutionSet format, to the
+/// coordinator.
+class ShardedEnumerate
+{
+public:
+  ShardedEnumerate(const CharacterMatrix& M,
+                   const StlDoubleVector& purityValues,
+                   const CompatibilityGraph& comp,
+                   int lowerbound);
+  
+  /// Branch first on the arcs that leave the largest upper bound
+  void setBoundOrdered(bool boundOrdered)
+  {
+    _boundOrdered = boundOrdered;
+  }
+  
+  /// Stop once token is cancelled: the workers are asked to stop and return
+  /// the trees found so far, which are merged as usual. The workers ignore
+  /// SIGINT and SIGTERM, these are handled by the coordinator
+  void setCancellationToken(const CancellationToken* token)
+  {
+    _cancellationToken = token;
+  }
+  
+  /// Enumerates the combinations in [offset, offset + state_tree_limit)
+  /// using the given number of worker processes, each with the given
+  /// number of threads. Throws std::runtime_error if a worker fails
+  void enumerate(int workers,
+                 int limit,
+                 int timeLimit,
+                 int threads,
+                 int state_tree_limit,
+                 bool monoclonal,
+                 int offset,
+                 const IntSet& whiteList);
+  
+  const SolutionSet& sols() const
+  {
+    return _sols;
+  }
+
+private:
+  struct Worker
+  {
+    pid_t _pid;
+    /// Write end of the command pipe
+    int _commandFd;
+    /// Write end of the bound pipe
+    int _boundFd;
+    /// Read end of the result pipe
+    int _resultFd;
+    /// Received data that does not form a complete message yet
+    std::string _buffer;
+    bool _active;
+  };
+  
+  typedef std::vector<Worker> WorkerVector;
+  
+  /// Milliseconds between checks of the lower bound of a worker
+  static const int BOUND_POLL_INTERVAL = 100;
+  /// Number of ranges handed out to each worker, if there are enough
+  /// combinations
+  static const int RANGES_PER_WORKER = 4;
+  
+  /// Forks a worker, only returns in the coordinator
+  void spawn(int limit,
+             int timeLimit,
+             int threads,
+             bool monoclonal,
+             const IntSet& whiteList,
+             Worker& worker);
+  
+  /// Main loop of a worker, does not return
+  void runWorker(int commandFd,
+                 int boundFd,
+                 int resultFd,
+                 int limit,
+                 int timeLimit,
+                 int threads,
+                 bool monoclonal,
+                 const IntSet& whiteList);
+  
+  /// Passes bounds from the bound pipe to alg and reports increases of the
+  /// lower bound of alg on the result pipe, until the bound pipe is closed.
+  /// Cancels cancellation on a 'cancel' line
+  void boundWorker(NoisyCnaEnumerate& alg,
+                   CancellationToken& cancellation,
+                   int boundFd,
+                   int resultFd);
+  
+  /// Sends the next range to worker, or stops it if all ranges have been
+  /// handed out
+  void assign(Worker& worker);
+  
+  /// Handles the complete messages in the buffer of worker
+  void process(int idx);
+  
+  /// Adds the solutions of a range, retaining only the largest trees
+  void merge(int treeSize, const SolutionSet& sols);
+  
+  void stop(Worker& worker);
+  
+  /// Waits for all workers to exit, after killing the active ones if kill
+  /// is set. Returns whether all workers exited normally
+  bool reap(bool kill);
+  
+  static bool readLine(int fd, std::string& line);
+  
+  static bool writeAll(int fd, const std::string& data);
+
+private:
+  const CharacterMatrix& _M;
+  const StlDoubleVector& _purityValues;
+  const CompatibilityGraph& _comp;
+  const int _lowerbound;
+  
+  /// Use bound-ordered exploration
+  bool _boundOrdered;
+  /// If set, the enumeration stops once this token is cancelled
+  const CancellationToken* _cancellationToken;
+  /// Whether the workers have been asked to stop
+  bool _cancelled;
+  WorkerVector _workers;
+  /// Next combination to hand out
+  int _nextCombination;
+  /// End of the combinations to enumerate
+  int _endCombination;
+  /// Number of combinations per range
+  int _rangeSize;
+  /// Largest lower bound on the tree size received from any worker
+  int _treeSizeBound;
+  /// Size of the trees in _sols
+  int _treeSize;
+  SolutionSet _sols;
+  /// Guards the result pipe of a worker
+  boost::mutex _resultMutex;
+};
+
+} // namespace gm
+
+#endif // SHARDEDENUMERATE_H
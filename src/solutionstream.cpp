@@ -0,0 +1,78 @@
+/*
+ * solutionstream.cpp
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#include "solutionstream.h"
+#include <iomanip>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+namespace gm {
+
+SolutionStream::SolutionStream(const std::string& filename,
+                               bool removeDuplicates)
+  : _filename(filename)
+  , _removeDuplicates(removeDuplicates)
+  , _out()
+  , _treeSize(0)
+  , _solutionCount(0)
+  , _mutex()
+{
+  reset();
+}
+
+void SolutionStream::reset()
+{
+  if (_out.is_open())
+  {
+    _out.close();
+  }
+  
+  _out.open(_filename.c_str(), std::ios::out | std::ios::trunc);
+  if (!_out.good())
+  {
+    throw std::runtime_error("Error: unable to open '" + _filename + "' for writing");
+  }
+  
+  _solutionCount = 0;
+  writeSolutionCount();
+}
+
+void SolutionStream::writeSolutionCount()
+{
+  // the count is padded so that it can be overwritten in place
+  std::streampos pos = _out.tellp();
+  _out.seekp(0);
+  _out << std::setw(COUNT_WIDTH) << _solutionCount << " # solutions" << std::endl << std::endl;
+  if (pos != std::streampos(0))
+  {
+    _out.seekp(pos);
+  }
+}
+
+bool SolutionStream::add(int treeSize, const Solution& sol)
+{
+  boost::interprocess::scoped_lock<boost::mutex> lock(_mutex);
+  
+  if (treeSize < _treeSize)
+  {
+    return false;
+  }
+  else if (treeSize > _treeSize)
+  {
+    if (_solutionCount > 0)
+    {
+      reset();
+    }
+    _treeSize = treeSize;
+  }
+  
+  _out << sol;
+  ++_solutionCount;
+  writeSolutionCount();
+  
+  return true;
+}
+
+} // namespace gm
@@ -0,0 +1,72 @@
+/*
+ * solutionstream.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef SOLUTIONSTREAM_H
+#define SOLUTIONSTREAM_H
+
+#include "utils.h"
+#include "solution.h"
+#include <fstream>
+#include <boost/thread/mutex.hpp>
+
+namespace gm {
+
+/// Writes solutions to a file as soon as they are found
+///
+/// Only solutions whose tree size equals the largest size seen so far are
+/// kept. A solution of larger size invalidates all solutions written
+/// before, in which case the file is truncated. The file has the format of
+/// a SolutionSet, the solution count on its first line is updated in place
+/// after every solution.
+///
+/// Unless removeDuplicates is false, the enumerations keep every written
+/// tree of the largest size in memory, so that a tree is written only once.
+class SolutionStream
+{
+public:
+  SolutionStream(const std::string& filename, bool removeDuplicates = true);
+  
+  /// Writes sol, returns false if sol was discarded because a solution
+  /// with a larger tree size was written before. Thread safe
+  bool add(int treeSize, const Solution& sol);
+  
+  int solutionCount() const
+  {
+    return _solutionCount;
+  }
+  
+  int treeSize() const
+  {
+    return _treeSize;
+  }
+  
+  /// Whether trees that were written before are to be discarded
+  bool removeDuplicates() const
+  {
+    return _removeDuplicates;
+  }
+
+private:
+  /// Width of the solution count on the first line
+  static const int COUNT_WIDTH = 10;
+  
+  /// Truncates the file
+  void reset();
+  
+  void writeSolutionCount();
+  
+  const std::string _filename;
+  const bool _removeDuplicates;
+  std::ofstream _out;
+  /// Tree size of the solutions in the file
+  int _treeSize;
+  int _solutionCount;
+  boost::mutex _mutex;
+};
+
+} // namespace gm
+
+#endif // SOLUTIONSTREAM_H
@@ -7,29 +7,15 @@
 
 #include <lemon/bfs.h>
 #include "stategraph.h"
+#include "statetreelibrary.h"
 
 namespace gm {
   
-StateGraph::Dictionary StateGraph::_dict = StateGraph::Dictionary();
-//StateGraph* StateGraph::_pG = NULL;
-  
 const StateGraph::StateEdgeSetSet& StateGraph::getStateTrees(const IntPairSet& L,
                                                              int xy_max_c,
                                                              bool includeMutationEdge)
 {
-//  if (_pG == NULL)
-//  {
-//    _pG = new StateGraph(xy_max_c);
-//  }
-  
-  StateGraph G(xy_max_c);
-  
-  if (_dict.find(L) == _dict.end())
-  {
-    G.enumerate(L, includeMutationEdge);
-    _dict[L] = G._result;
-  }
-  return _dict[L];
+  return StateTreeLibrary::instance().get(L, xy_max_c, includeMutationEdge);
 }
   
 StateGraph::StateGraph(int max_x)
@@ -153,6 +153,14 @@ private:
   StateEdgeSetSet _result;
   
 public:
+  /// State trees found by the last call to enumerate()
+  const StateEdgeSetSet& stateTrees() const
+  {
+    return _result;
+  }
+  
+  /// Returns the state trees of L, looked up in StateTreeLibrary::instance().
+  /// Thread safe
   static const StateEdgeSetSet& getStateTrees(const IntPairSet& L,
                                               int xy_max_c,
                                               bool includeMutationEdge);
@@ -176,11 +184,6 @@ public:
       print(S, std::cout);
     }
   }
-  
-private:
-  typedef std::map<IntPairSet, StateEdgeSetSet> Dictionary;
-  static Dictionary _dict;
-//  static std::mapStateGraph* _pG;
 };
   
 bool operator<(const StateGraph::CnaTriple& lhs, const StateGraph::CnaTriple& rhs);
@@ -0,0 +1,240 @@
+/*
+ * statetreelibrary.cpp
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#include "statetreelibrary.h"
+#include <boost/thread.hpp>
+
+namespace gm {
+
+StateTreeLibrary::StateTreeLibrary()
+  : _map()
+  , _mutex()
+  , _modified(false)
+{
+}
+
+StateTreeLibrary& StateTreeLibrary::instance()
+{
+  static StateTreeLibrary library;
+  return library;
+}
+
+const StateTreeLibrary::StateEdgeSetSet& StateTreeLibrary::get(const IntPairSet& L,
+                                                               int max_x,
+                                                               bool includeMutationEdge)
+{
+  const Key key(L, max_x, includeMutationEdge);
+  {
+    boost::shared_lock<boost::shared_mutex> lock(_mutex);
+    Map::const_iterator it = _map.find(key);
+    if (it != _map.end())
+    {
+      return it->second;
+    }
+  }
+  
+  // build the state graph without holding the lock, a key that is looked
+  // up concurrently may be enumerated more than once
+  StateGraph G(max_x);
+  G.enumerate(L, includeMutationEdge);
+  
+  boost::unique_lock<boost::shared_mutex> lock(_mutex);
+  std::pair<Map::iterator, bool> res = _map.insert(std::make_pair(key, G.stateTrees()));
+  if (res.second)
+  {
+    _modified = true;
+  }
+  return res.first->second;
+}
+
+void StateTreeLibrary::precompute(int max_x, int threads)
+{
+  if (max_x > MAX_PRECOMPUTE_X)
+  {
+    throw std::runtime_error("Error: state trees can only be precomputed up to copy number "
+                             + std::to_string(MAX_PRECOMPUTE_X));
+  }
+  
+  // copy states (x,y) with y <= x as in the state graph, (1,1) is in every L
+  std::vector<IntPair> copyStates;
+  for (int x = 0; x <= max_x; ++x)
+  {
+    for (int y = 0; y <= x; ++y)
+    {
+      if (x != 1 || y != 1)
+      {
+        copyStates.push_back(IntPair(x, y));
+      }
+    }
+  }
+  
+  KeyVector keys;
+  const unsigned long subsets = 1UL << copyStates.size();
+  for (unsigned long subset = 0; subset < subsets; ++subset)
+  {
+    IntPairSet L;
+    L.insert(IntPair(1, 1));
+    int max_x_L = 1;
+    for (int i = 0; i < copyStates.size(); ++i)
+    {
+      if (subset & (1UL << i))
+      {
+        L.insert(copyStates[i]);
+        max_x_L = std::max(max_x_L, copyStates[i].first);
+      }
+    }
+    
+    for (int max_x_G = max_x_L; max_x_G <= max_x; ++max_x_G)
+    {
+      keys.push_back(Key(L, max_x_G, false));
+      keys.push_back(Key(L, max_x_G, true));
+    }
+  }
+  
+  boost::atomic<int> nextKey(0);
+  boost::thread_group threadGroup;
+  for (int i = 0; i < std::max(1, threads); ++i)
+  {
+    threadGroup.create_thread(boost::bind(&StateTreeLibrary::precomputeWorker, this,
+                                          boost::cref(keys),
+                                          boost::ref(nextKey)));
+  }
+  threadGroup.join_all();
+}
+
+void StateTreeLibrary::precomputeWorker(const KeyVector& keys,
+                                        boost::atomic<int>& nextKey)
+{
+  const int nrKeys = keys.size();
+  for (int idx = nextKey++; idx < nrKeys; idx = nextKey++)
+  {
+    const Key& key = keys[idx];
+    get(key._L, key._max_x, key._includeMutationEdge);
+  }
+}
+
+int StateTreeLibrary::size() const
+{
+  boost::shared_lock<boost::shared_mutex> lock(_mutex);
+  return _map.size();
+}
+
+bool StateTreeLibrary::modified() const
+{
+  boost::shared_lock<boost::shared_mutex> lock(_mutex);
+  return _modified;
+}
+
+template<typename T>
+void StateTreeLibrary::writeValue(std::ostream& out, T value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+T StateTreeLibrary::readValue(std::istream& in)
+{
+  T value;
+  if (!in.read(reinterpret_cast<char*>(&value), sizeof(T)))
+  {
+    throw std::runtime_error("Error: unexpected end of state tree library");
+  }
+  return value;
+}
+
+void StateTreeLibrary::write(std::ostream& out)
+{
+  boost::unique_lock<boost::shared_mutex> lock(_mutex);
+  
+  writeValue<uint32_t>(out, MAGIC);
+  writeValue<uint32_t>(out, _map.size());
+  for (const auto& entry : _map)
+  {
+    const Key& key = entry.first;
+    writeValue<int32_t>(out, key._max_x);
+    writeValue<uint8_t>(out, key._includeMutationEdge);
+    writeValue<uint32_t>(out, key._L.size());
+    for (const IntPair& xy : key._L)
+    {
+      writeValue<int32_t>(out, xy.first);
+      writeValue<int32_t>(out, xy.second);
+    }
+    
+    writeValue<uint32_t>(out, entry.second.size());
+    for (const StateGraph::StateEdgeSet& S : entry.second)
+    {
+      writeValue<uint32_t>(out, S.size());
+      for (const StateGraph::StateEdge& st : S)
+      {
+        writeValue<int32_t>(out, st.first._x);
+        writeValue<int32_t>(out, st.first._y);
+        writeValue<int32_t>(out, st.first._z);
+        writeValue<int32_t>(out, st.second._x);
+        writeValue<int32_t>(out, st.second._y);
+        writeValue<int32_t>(out, st.second._z);
+      }
+    }
+  }
+  
+  _modified = false;
+}
+
+void StateTreeLibrary::read(std::istream& in)
+{
+  if (readValue<uint32_t>(in) != MAGIC)
+  {
+    throw std::runtime_error("Error: not a state tree library");
+  }
+  
+  Map map;
+  const uint32_t nrKeys = readValue<uint32_t>(in);
+  for (uint32_t idx = 0; idx < nrKeys; ++idx)
+  {
+    const int max_x = readValue<int32_t>(in);
+    const bool includeMutationEdge = readValue<uint8_t>(in) != 0;
+    if (max_x < 0)
+    {
+      throw std::runtime_error("Error: invalid maximum copy number in state tree library");
+    }
+    
+    IntPairSet L;
+    const uint32_t nrCopyStates = readValue<uint32_t>(in);
+    for (uint32_t i = 0; i < nrCopyStates; ++i)
+    {
+      const int x = readValue<int32_t>(in);
+      const int y = readValue<int32_t>(in);
+      L.insert(L.end(), IntPair(x, y));
+    }
+    
+    // keys, trees and edges are written in order, insert at the end
+    StateEdgeSetSet& setS = map.insert(map.end(), std::make_pair(Key(L, max_x, includeMutationEdge),
+                                                                 StateEdgeSetSet()))->second;
+    const uint32_t nrTrees = readValue<uint32_t>(in);
+    for (uint32_t i = 0; i < nrTrees; ++i)
+    {
+      StateGraph::StateEdgeSet S;
+      const uint32_t nrEdges = readValue<uint32_t>(in);
+      for (uint32_t j = 0; j < nrEdges; ++j)
+      {
+        StateGraph::StateEdge st;
+        st.first._x = readValue<int32_t>(in);
+        st.first._y = readValue<int32_t>(in);
+        st.first._z = readValue<int32_t>(in);
+        st.second._x = readValue<int32_t>(in);
+        st.second._y = readValue<int32_t>(in);
+        st.second._z = readValue<int32_t>(in);
+        S.insert(S.end(), st);
+      }
+      setS.insert(setS.end(), S);
+    }
+  }
+  
+  boost::unique_lock<boost::shared_mutex> lock(_mutex);
+  _map.insert(map.begin(), map.end());
+  _modified = _map.size() > map.size();
+}
+
+} // namespace gm
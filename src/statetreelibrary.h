@@ -0,0 +1,116 @@
+/*
+ * statetreelibrary.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef STATETREELIBRARY_H
+#define STATETREELIBRARY_H
+
+#include "utils.h"
+#include "stategraph.h"
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/atomic.hpp>
+#include <stdint.h>
+
+namespace gm {
+
+/// Cache of the state trees enumerated by StateGraph::enumerate
+///
+/// An entry is keyed on the copy-state set L, the maximum copy number of
+/// the state graph and whether a mutation edge is included. The state
+/// graph of a key is only built when the key is looked up for the first
+/// time. Lookups are thread safe and do not block each other once the key
+/// is present. A library can be written to and read from a binary file,
+/// so that common copy-state sets need not be enumerated in every run.
+class StateTreeLibrary
+{
+public:
+  typedef StateGraph::IntPairSet IntPairSet;
+  typedef StateGraph::StateEdgeSetSet StateEdgeSetSet;
+  
+  StateTreeLibrary();
+  
+  /// Library used by StateGraph::getStateTrees
+  static StateTreeLibrary& instance();
+  
+  /// Returns the state trees of L in the state graph with maximum copy
+  /// number max_x. The returned reference remains valid. Thread safe
+  const StateEdgeSetSet& get(const IntPairSet& L,
+                             int max_x,
+                             bool includeMutationEdge);
+  
+  /// Largest max_x accepted by precompute(), the number of copy-state sets
+  /// is 2^((max_x+1)(max_x+2)/2 - 1)
+  static const int MAX_PRECOMPUTE_X = 3;
+  
+  /// Adds the state trees of all copy-state sets L containing (1,1) with
+  /// copy numbers at most max_x, for each state graph with maximum copy
+  /// number from the largest copy number in L up to max_x, with and without
+  /// mutation edge. Uses the given number of threads
+  void precompute(int max_x, int threads);
+  
+  /// Number of keys
+  int size() const;
+  
+  /// Returns whether there are keys that are not in the library last read
+  /// or written
+  bool modified() const;
+  
+  /// Adds the keys of a library written by write(), throws
+  /// std::runtime_error if the input is not such a library
+  void read(std::istream& in);
+  
+  void write(std::ostream& out);
+
+private:
+  struct Key
+  {
+    Key(const IntPairSet& L, int max_x, bool includeMutationEdge)
+      : _L(L)
+      , _max_x(max_x)
+      , _includeMutationEdge(includeMutationEdge)
+    {
+    }
+    
+    bool operator<(const Key& other) const
+    {
+      if (_max_x != other._max_x)
+        return _max_x < other._max_x;
+      if (_includeMutationEdge != other._includeMutationEdge)
+        return _includeMutationEdge < other._includeMutationEdge;
+      return _L < other._L;
+    }
+    
+    IntPairSet _L;
+    int _max_x;
+    bool _includeMutationEdge;
+  };
+  
+  typedef std::map<Key, StateEdgeSetSet> Map;
+  typedef std::vector<Key> KeyVector;
+  
+  /// Looks up the keys handed out by nextKey
+  void precomputeWorker(const KeyVector& keys,
+                        boost::atomic<int>& nextKey);
+  
+  template<typename T>
+  static void writeValue(std::ostream& out, T value);
+  
+  template<typename T>
+  static T readValue(std::istream& in);
+  
+  /// Identifies the binary format
+  static const uint32_t MAGIC = 0x53545231;
+
+private:
+  /// Entries are never removed, so references to them remain valid
+  Map _map;
+  /// Guards _map and _modified
+  mutable boost::shared_mutex _mutex;
+  bool _modified;
+};
+
+} // namespace gm
+
+#endif // STATETREELIBRARY_H
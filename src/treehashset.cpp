@@ -0,0 +1,109 @@
+/*
+ * treehashset.cpp
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#include "treehashset.h"
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+namespace gm {
+
+TreeHashSet::TreeHashSet()
+  : _shards()
+  , _treeSize(0)
+{
+}
+
+bool TreeHashSet::insert(const CanonicalTree& tree, int treeSize, int owner)
+{
+  assert(std::is_sorted(tree.begin(), tree.end()));
+  
+  int current = _treeSize;
+  while (current < treeSize && !_treeSize.compare_exchange_weak(current, treeSize));
+  if (current < treeSize)
+  {
+    evict(treeSize);
+  }
+  else if (treeSize < current)
+  {
+    return false;
+  }
+  
+  const size_t hash = CanonicalTreeHash()(tree);
+  Shard& shard = _shards[hash % NR_SHARDS];
+  
+  boost::interprocess::scoped_lock<boost::mutex> lock(shard._mutex);
+  // another thread may not have evicted this shard yet
+  if (treeSize < shard._treeSize)
+  {
+    return false;
+  }
+  else if (treeSize > shard._treeSize)
+  {
+    shard._trees.clear();
+    shard._treeSize = treeSize;
+  }
+  
+  std::pair<CanonicalTreeMap::iterator, bool> res = shard._trees.insert(std::make_pair(tree, owner));
+  if (res.second)
+  {
+    return true;
+  }
+  else if (owner < res.first->second)
+  {
+    res.first->second = owner;
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+int TreeHashSet::owner(const CanonicalTree& tree) const
+{
+  const size_t hash = CanonicalTreeHash()(tree);
+  const Shard& shard = _shards[hash % NR_SHARDS];
+  
+  boost::interprocess::scoped_lock<boost::mutex> lock(shard._mutex);
+  CanonicalTreeMap::const_iterator it = shard._trees.find(tree);
+  return it == shard._trees.end() ? -1 : it->second;
+}
+
+void TreeHashSet::evict(int treeSize)
+{
+  for (int i = 0; i < NR_SHARDS; ++i)
+  {
+    boost::interprocess::scoped_lock<boost::mutex> lock(_shards[i]._mutex);
+    if (_shards[i]._treeSize < treeSize)
+    {
+      _shards[i]._trees.clear();
+      _shards[i]._treeSize = treeSize;
+    }
+  }
+}
+
+void TreeHashSet::clear()
+{
+  for (int i = 0; i < NR_SHARDS; ++i)
+  {
+    boost::interprocess::scoped_lock<boost::mutex> lock(_shards[i]._mutex);
+    _shards[i]._trees.clear();
+    _shards[i]._treeSize = 0;
+  }
+  _treeSize = 0;
+}
+
+size_t TreeHashSet::size() const
+{
+  size_t res = 0;
+  for (int i = 0; i < NR_SHARDS; ++i)
+  {
+    boost::interprocess::scoped_lock<boost::mutex> lock(_shards[i]._mutex);
+    res += _shards[i]._trees.size();
+  }
+  return res;
+}
+
+} // namespace gm
@@ -0,0 +1,81 @@
+/*
+ * treehashset.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef TREEHASHSET_H
+#define TREEHASHSET_H
+
+#include "utils.h"
+#include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/atomic.hpp>
+
+namespace gm {
+
+/// Thread-safe set of trees, used to detect trees that are found more than once
+///
+/// A tree is identified by its canonical form: the sorted list of its
+/// (char,state) parent/child pairs. The set is split into shards, each with
+/// its own lock, so that concurrent insertions rarely contend. Only trees of
+/// the largest size inserted so far are kept, as smaller trees are not
+/// reported anyway.
+///
+/// Each tree has an owner, e.g. the state tree combination it was found in.
+/// A tree inserted again with a lower owner changes owner, so that the
+/// final owner of a tree does not depend on the order of insertion.
+class TreeHashSet
+{
+public:
+  typedef std::pair<IntPair, IntPair> CharStateArc;
+  typedef std::vector<CharStateArc> CanonicalTree;
+  
+  TreeHashSet();
+  
+  /// Inserts tree, which must be sorted, of size treeSize. Smaller trees
+  /// are evicted. Returns false if tree was present already with an owner
+  /// at most owner, or if a larger tree was inserted before. Thread safe
+  bool insert(const CanonicalTree& tree, int treeSize, int owner = 0);
+  
+  /// Returns the owner of tree, or -1 if it is not present. Thread safe
+  int owner(const CanonicalTree& tree) const;
+  
+  void clear();
+  
+  size_t size() const;
+
+private:
+  typedef boost::hash<CanonicalTree> CanonicalTreeHash;
+  typedef boost::unordered_map<CanonicalTree, int, CanonicalTreeHash> CanonicalTreeMap;
+  
+  static const int NR_SHARDS = 64;
+  
+  struct Shard
+  {
+    Shard()
+      : _trees()
+      , _treeSize(0)
+      , _mutex()
+    {
+    }
+    
+    /// Trees and their owners
+    CanonicalTreeMap _trees;
+    /// Size of the trees in _trees
+    int _treeSize;
+    mutable boost::mutex _mutex;
+  };
+  
+  /// Evicts the trees smaller than treeSize from all shards
+  void evict(int treeSize);
+  
+  Shard _shards[NR_SHARDS];
+  /// Size of the largest tree inserted
+  boost::atomic<int> _treeSize;
+};
+
+} // namespace gm
+
+#endif // TREEHASHSET_H
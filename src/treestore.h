@@ -0,0 +1,149 @@
+/*
+ * treestore.h
+ *
+ *  Created on: 18-oct-2026
+ */
+
+#ifndef TREESTORE_H
+#define TREESTORE_H
+
+#include "utils.h"
+#include "compactdigraph.h"
+#include <sstream>
+
+namespace gm {
+
+/// Collection of trees, each stored as the ids of its arcs
+///
+/// The arc ids of all trees are kept in a single buffer, tree idx consists
+/// of the arcs in [begin(idx), end(idx)). Trees are accessed in constant
+/// time and take one integer per arc.
+class TreeStore
+{
+public:
+  TreeStore()
+    : _arcs()
+    , _offsets(1, 0)
+  {
+  }
+  
+  int size() const
+  {
+    return _offsets.size() - 1;
+  }
+  
+  bool empty() const
+  {
+    return _offsets.size() == 1;
+  }
+  
+  /// Removes all trees, keeping the allocated buffers
+  void clear()
+  {
+    _arcs.clear();
+    _offsets.resize(1);
+  }
+  
+  /// Appends the tree consisting of the arcs of T
+  void add(const CompactSubDigraph& T)
+  {
+    const CompactDigraph& G = T.compactG();
+    for (CompactSubDigraph::ArcIt a(T); a != lemon::INVALID; ++a)
+    {
+      _arcs.push_back(G.id(a));
+    }
+    _offsets.push_back(_arcs.size());
+  }
+  
+  const int* begin(int idx) const
+  {
+    assert(0 <= idx && idx < size());
+    return _arcs.data() + _offsets[idx];
+  }
+  
+  const int* end(int idx) const
+  {
+    assert(0 <= idx && idx < size());
+    return _arcs.data() + _offsets[idx + 1];
+  }
+  
+  /// Enables the arcs of tree idx and their endpoints in T
+  void init(int idx, CompactSubDigraph& T) const
+  {
+    const CompactDigraph& G = T.compactG();
+    for (const int* it = begin(idx); it != end(idx); ++it)
+    {
+      const int a = *it;
+      T.arcs().set(a);
+      T.nodes().set(G.sourceId(a));
+      T.nodes().set(G.targetId(a));
+    }
+  }
+
+  friend std::ostream& operator<<(std::ostream& out, const TreeStore& trees);
+  friend std::istream& operator>>(std::istream& in, TreeStore& trees);
+
+private:
+  /// Arc ids of all trees
+  StlIntVector _arcs;
+  /// Tree idx occupies _arcs[_offsets[idx], _offsets[idx+1])
+  std::vector<size_t> _offsets;
+};
+  
+/// Writes the number of trees followed by the arc ids of each tree on a
+/// separate line
+inline std::ostream& operator<<(std::ostream& out, const TreeStore& trees)
+{
+  out << trees.size() << " #trees" << std::endl;
+  for (int idx = 0; idx < trees.size(); ++idx)
+  {
+    for (const int* it = trees.begin(idx); it != trees.end(idx); ++it)
+    {
+      if (it != trees.begin(idx))
+        out << " ";
+      out << *it;
+    }
+    out << std::endl;
+  }
+  return out;
+}
+  
+inline std::istream& operator>>(std::istream& in, TreeStore& trees)
+{
+  std::string line;
+  gm::getline(in, line);
+  std::stringstream ss(line);
+  
+  int treeCount = -1;
+  ss >> treeCount;
+  if (treeCount < 0)
+  {
+    throw std::runtime_error(getLineNumber() + "Error: invalid number of trees");
+  }
+  
+  trees.clear();
+  for (int idx = 0; idx < treeCount; ++idx)
+  {
+    gm::getline(in, line);
+    ss.clear();
+    ss.str(line);
+    
+    int a = -1;
+    while (ss >> a)
+    {
+      trees._arcs.push_back(a);
+    }
+    if (!ss.eof() || trees._arcs.size() == trees._offsets.back())
+    {
+      throw std::runtime_error(getLineNumber() + "Error: '" + line
+                               + "' is not a list of arc ids");
+    }
+    trees._offsets.push_back(trees._arcs.size());
+  }
+  
+  return in;
+}
+
+} // namespace gm
+
+#endif // TREESTORE_H
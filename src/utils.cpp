@@ -7,6 +7,7 @@
 
 #include "utils.h"
 #include <stdio.h>
+#include <limits>
 
 namespace gm {
 
@@ -63,6 +64,79 @@ std::istream& getline(std::istream& is, std::string& t)
   }
 }
   
+const char* getline(const char* first, const char* last, const char*& lineLast)
+{
+  ++g_lineNumber;
+  
+  const char* it = first;
+  while (it != last && *it != '\n' && *it != '\r')
+  {
+    ++it;
+  }
+  lineLast = it;
+  
+  if (it == last)
+    return last;
+  if (*it == '\r' && it + 1 != last && *(it + 1) == '\n')
+    return it + 2;
+  return it + 1;
+}
+  
+bool parseInt(const char* first, const char* last, int& value)
+{
+  bool negative = false;
+  if (first != last && (*first == '-' || *first == '+'))
+  {
+    negative = *first == '-';
+    ++first;
+  }
+  if (first == last)
+    return false;
+  
+  long long res = 0;
+  for (; first != last; ++first)
+  {
+    if (*first < '0' || *first > '9')
+      return false;
+    res = 10 * res + (*first - '0');
+    if (res > static_cast<long long>(std::numeric_limits<int>::max()) + 1)
+      return false;
+  }
+  
+  res = negative ? -res : res;
+  if (res > std::numeric_limits<int>::max())
+    return false;
+  
+  value = static_cast<int>(res);
+  return true;
+}
+  
+bool parseDouble(const char* first, const char* last, double& value)
+{
+  if (first == last)
+    return false;
+  
+  // strtod needs a terminated string, the buffer need not be terminated
+  char buf[64];
+  const size_t length = last - first;
+  std::string str;
+  const char* cstr = buf;
+  if (length < sizeof(buf))
+  {
+    std::copy(first, last, buf);
+    buf[length] = '\0';
+  }
+  else
+  {
+    str.assign(first, last);
+    cstr = str.c_str();
+  }
+  
+  char* end = NULL;
+  value = strtod(cstr, &end);
+  return end == cstr + length;
+}
+  
 std::ostream& operator<<(std::ostream& out, const StlBoolMatrix& M)
 {
   int m = M.size();
@@ -97,6 +97,17 @@ StlBoolMatrix discretize(const StlDoubleMatrix& M);
   
 std::istream& getline(std::istream& is, std::string& t);
   
+/// Line reading on a character buffer: sets lineLast to the end of the line
+/// starting at first and returns the start of the next line. Lines end as
+/// in getline, and g_lineNumber is incremented likewise
+const char* getline(const char* first, const char* last, const char*& lineLast);
+  
+/// Returns whether [first, last) is an integer that fits in an int
+bool parseInt(const char* first, const char* last, int& value);
+  
+/// Returns whether [first, last) is a floating-point number
+bool parseDouble(const char* first, const char* last, double& value);
+  
 extern lemon::Tolerance<double> g_tol;
 
 } // namespace gm